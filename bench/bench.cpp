@@ -0,0 +1,335 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+/*
+ * Native micro-benchmarks for ThingSet request processing and publication messages
+ *
+ * Synthetic data node trees of different sizes are generated and each request is processed
+ * repeatedly to determine the time per request and the throughput in bytes of generated
+ * response (or publication message) per second.
+ *
+ * Usage: program [--json] [--min-time-ms <ms>]
+ *
+ * With --json, each result is printed as a JSON object in a separate line (JSON lines format)
+ * so that results can be compared automatically.
+ */
+
+#include "bench.h"
+
+#include "thingset.h"
+#include "cbor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+#include <string>
+#include <vector>
+
+#define PUB_SER     (1U << 0)
+#define PUB_CAN     (1U << 1)
+
+#define NODES_PER_GROUP     10      // one path node and its children
+#define NUM_PUB_NODES       10      // number of nodes in each publication channel
+
+#if TS_32BIT_NODE_IDS
+static const size_t tree_sizes[] = { 100, 1000, 10000, 100000 };
+#else
+static const size_t tree_sizes[] = { 100, 1000, 10000 };
+#endif
+
+#define NUM_LOOKUP_IDS      1024    // number of random IDs used for lookup benchmarks
+
+bool json_output = false;
+unsigned int min_time_ms = 200;
+
+static int exec_counter;
+
+static int32_t exec_param_int;
+static float exec_param_float;
+static bool exec_param_bool;
+
+static void exec_function()
+{
+    exec_counter++;
+}
+
+/*
+ * Values of all data nodes below one path node
+ */
+typedef struct {
+    float f[4];
+    int32_t i[2];
+    uint16_t u;
+    bool b;
+    char s[16];
+} GroupData;
+
+/*
+ * Synthetic data node tree consisting of groups with NODES_PER_GROUP nodes each, followed by
+ * an executable node with 3 parameters
+ *
+ * With 32-bit node IDs, each group uses a separate ID range (like a gateway mirroring the data
+ * of different devices), otherwise the IDs are assigned consecutively.
+ */
+class SyntheticTree
+{
+public:
+    SyntheticTree(size_t num_nodes)
+    {
+        num_groups = (num_nodes - 4) / NODES_PER_GROUP;
+        if (num_groups < 1) {
+            num_groups = 1;
+        }
+        values.resize(num_groups);
+        nodes.reserve(num_groups * NODES_PER_GROUP + 4);
+
+        node_id_t id = 1;
+        for (size_t g = 0; g < num_groups; g++) {
+            GroupData *v = &values[g];
+#if TS_32BIT_NODE_IDS
+            id = (g + 1) << 8;
+#endif
+            node_id_t group_id = id++;
+            v->f[0] = 14.1F + g;
+            v->f[1] = -5.13F;
+            v->f[2] = 0.001F * g;
+            v->f[3] = 1234.5F;
+            v->i[0] = -12345 - g;
+            v->i[1] = g;
+            v->u = g;
+            v->b = (g % 2) == 0;
+            snprintf(v->s, sizeof(v->s), "group %d", (int)g);
+
+            nodes.push_back(TS_NODE_PATH(group_id, name("g%d", g), 0, NULL));
+            nodes.push_back(TS_NODE_FLOAT(id++, "f0", &v->f[0], 2, group_id, TS_ANY_RW, 0));
+            nodes.push_back(TS_NODE_FLOAT(id++, "f1", &v->f[1], 2, group_id, TS_ANY_RW, 0));
+            nodes.push_back(TS_NODE_FLOAT(id++, "f2", &v->f[2], 3, group_id, TS_ANY_RW, 0));
+            nodes.push_back(TS_NODE_FLOAT(id++, "f3", &v->f[3], 1, group_id, TS_ANY_RW, 0));
+            nodes.push_back(TS_NODE_INT32(id++, "i0", &v->i[0], group_id, TS_ANY_RW, 0));
+            nodes.push_back(TS_NODE_INT32(id++, "i1", &v->i[1], group_id, TS_ANY_RW, 0));
+            nodes.push_back(TS_NODE_UINT16(id++, "u0", &v->u, group_id, TS_ANY_RW, 0));
+            nodes.push_back(TS_NODE_BOOL(id++, "b0", &v->b, group_id, TS_ANY_RW, 0));
+            nodes.push_back(TS_NODE_STRING(id++, "s0", v->s, sizeof(v->s), group_id,
+                TS_ANY_RW, 0));
+        }
+
+#if TS_32BIT_NODE_IDS
+        id = (num_groups + 1) << 8;
+#endif
+        exec_id = id++;
+        nodes.push_back(TS_NODE_EXEC(exec_id, "run", &exec_function, 0, TS_ANY_RW));
+        nodes.push_back(TS_NODE_INT32(id++, "Int", &exec_param_int, exec_id, TS_ANY_RW, 0));
+        nodes.push_back(TS_NODE_FLOAT(id++, "Float", &exec_param_float, 2, exec_id,
+            TS_ANY_RW, 0));
+        nodes.push_back(TS_NODE_BOOL(id++, "Bool", &exec_param_bool, exec_id, TS_ANY_RW, 0));
+
+        // distribute published nodes over the entire tree
+        for (size_t i = 0; i < NUM_PUB_NODES; i++) {
+            size_t g = i * num_groups / NUM_PUB_NODES;
+            DataNode *node = &nodes[g * NODES_PER_GROUP + 1];
+            // larger IDs don't fit into the CAN ID
+            node->pubsub = (node->id <= 0xFFFF) ? (PUB_SER | PUB_CAN) : PUB_SER;
+        }
+
+        // requests are sent to the last group (worst case for linear searches)
+        last_group = &nodes[(num_groups - 1) * NODES_PER_GROUP];
+    }
+
+    std::vector<DataNode> nodes;
+    std::vector<GroupData> values;
+    size_t num_groups;
+    node_id_t exec_id;
+    const DataNode *last_group;
+
+private:
+    const char *name(const char *fmt, size_t num)
+    {
+        char buf[16];
+        snprintf(buf, sizeof(buf), fmt, (int)num);
+        names.push_back(buf);
+        return names.back().c_str();
+    }
+
+    std::deque<std::string> names;     // deque does not move elements when growing
+};
+
+/*
+ * Processes a request and checks for a successful response
+ */
+static int request(ThingSet &ts, const uint8_t *req, size_t req_len, uint8_t *resp,
+    size_t resp_size)
+{
+    int len = ts.process((uint8_t *)req, req_len, resp, resp_size);
+    bool success = (req[0] < 0x20) ? (resp[0] >= TS_STATUS_CREATED && resp[0] <= 0x85) :
+        (len > 3 && resp[0] == ':' && resp[1] == '8');
+    return success ? len : -1;
+}
+
+/*
+ * Total length of a scatter-gather response (-1 for error)
+ */
+static int iov_len(const TsIoVec *iov, int count)
+{
+    int len = 0;
+    for (int i = 0; i < count; i++) {
+        len += iov[i].len;
+    }
+    return count > 0 ? len : -1;
+}
+
+static void bench_tree(size_t size)
+{
+    static uint8_t req[1000];
+    static uint8_t resp[10000];
+    static char pub_msg[1000];
+
+    SyntheticTree tree(size);
+    ThingSet ts(tree.nodes.data(), tree.nodes.size());
+    size_t num_nodes = tree.nodes.size();
+    const DataNode *group = tree.last_group;
+    size_t len;
+
+    // lookups
+
+    node_id_t ids[NUM_LOOKUP_IDS];
+    uint32_t rand_state = 12345;
+    for (unsigned int i = 0; i < NUM_LOOKUP_IDS; i++) {
+        rand_state = rand_state * 1103515245 + 12345;
+        ids[i] = tree.nodes[(rand_state >> 8) % num_nodes].id;
+    }
+    unsigned int lookup = 0;
+    run("get_node_id", num_nodes, [&]() {
+        lookup = (lookup + 1) % NUM_LOOKUP_IDS;
+        return ts.get_node(ids[lookup]) != NULL ? 0 : -1;
+    });
+
+    char path[20];
+    snprintf(path, sizeof(path), "%s/s0", group->name);
+    run("get_endpoint", num_nodes, [&]() {
+        return ts.get_endpoint(path, strlen(path)) != NULL ? 0 : -1;
+    });
+
+    // text mode
+
+    len = snprintf((char *)req, sizeof(req), "?%s", group->name);
+    run("txt_get", num_nodes, [&]() { return request(ts, req, len, resp, sizeof(resp)); });
+
+    static TsIoVec iov[100];
+    run("txt_get_iov", num_nodes, [&]() {
+        return iov_len(iov, ts.process(req, len, iov, 100, resp, sizeof(resp)));
+    });
+
+    len = snprintf((char *)req, sizeof(req), "?%s [\"f0\",\"i0\",\"b0\",\"s0\"]", group->name);
+    run("txt_fetch", num_nodes, [&]() { return request(ts, req, len, resp, sizeof(resp)); });
+
+    len = snprintf((char *)req, sizeof(req), "=%s {\"f0\":52.8,\"i0\":-42,\"b0\":true}",
+        group->name);
+    run("txt_patch", num_nodes, [&]() { return request(ts, req, len, resp, sizeof(resp)); });
+
+    len = snprintf((char *)req, sizeof(req), "!run [1,2.5,true]");
+    run("txt_exec", num_nodes, [&]() { return request(ts, req, len, resp, sizeof(resp)); });
+
+    run("txt_pub", num_nodes, [&]() {
+        return ts.txt_pub(pub_msg, sizeof(pub_msg), PUB_SER);
+    });
+
+    run("txt_pub_iov", num_nodes, [&]() {
+        return iov_len(iov, ts.txt_pub(iov, 100, pub_msg, sizeof(pub_msg), PUB_SER));
+    });
+
+    ts.enable_pub_template(PUB_SER);
+    run("txt_pub_tpl", num_nodes, [&]() {
+        return ts.txt_pub(pub_msg, sizeof(pub_msg), PUB_SER);
+    });
+    ts.disable_pub_template(PUB_SER);
+
+    // binary mode
+
+    len = 0;
+    req[len++] = TS_GET;
+    len += cbor_serialize_uint(&req[len], group->id, sizeof(req) - len);
+    req[len++] = 0xA0;  // empty map: values are requested
+    run("bin_get", num_nodes, [&]() { return request(ts, req, len, resp, sizeof(resp)); });
+
+    len = 0;
+    req[len++] = TS_FETCH;
+    len += cbor_serialize_uint(&req[len], group->id, sizeof(req) - len);
+    len += cbor_serialize_array(&req[len], 4, sizeof(req) - len);
+    len += cbor_serialize_uint(&req[len], group[1].id, sizeof(req) - len);      // f0
+    len += cbor_serialize_uint(&req[len], group[5].id, sizeof(req) - len);      // i0
+    len += cbor_serialize_uint(&req[len], group[8].id, sizeof(req) - len);      // b0
+    len += cbor_serialize_uint(&req[len], group[9].id, sizeof(req) - len);      // s0
+    run("bin_fetch", num_nodes, [&]() { return request(ts, req, len, resp, sizeof(resp)); });
+
+    len = 0;
+    req[len++] = TS_PATCH;
+    len += cbor_serialize_uint(&req[len], group->id, sizeof(req) - len);
+    len += cbor_serialize_map(&req[len], 3, sizeof(req) - len);
+    len += cbor_serialize_uint(&req[len], group[1].id, sizeof(req) - len);
+    len += cbor_serialize_float(&req[len], 52.8F, sizeof(req) - len);
+    len += cbor_serialize_uint(&req[len], group[5].id, sizeof(req) - len);
+    len += cbor_serialize_int(&req[len], (int32_t)-42, sizeof(req) - len);
+    len += cbor_serialize_uint(&req[len], group[8].id, sizeof(req) - len);
+    len += cbor_serialize_bool(&req[len], true, sizeof(req) - len);
+    run("bin_patch", num_nodes, [&]() { return request(ts, req, len, resp, sizeof(resp)); });
+
+    len = 0;
+    req[len++] = TS_POST;
+    len += cbor_serialize_uint(&req[len], tree.exec_id, sizeof(req) - len);
+    len += cbor_serialize_array(&req[len], 3, sizeof(req) - len);
+    len += cbor_serialize_int(&req[len], (int32_t)1, sizeof(req) - len);
+    len += cbor_serialize_float(&req[len], 2.5F, sizeof(req) - len);
+    len += cbor_serialize_bool(&req[len], true, sizeof(req) - len);
+    run("bin_exec", num_nodes, [&]() { return request(ts, req, len, resp, sizeof(resp)); });
+
+    run("bin_pub", num_nodes, [&]() {
+        return ts.bin_pub((uint8_t *)pub_msg, sizeof(pub_msg), PUB_SER);
+    });
+
+    // one CAN message per call, wrapping around after the last node of the channel
+    int start_pos = 0;
+    run("bin_pub_can", num_nodes, [&]() {
+        uint32_t msg_id;
+        uint8_t msg_data[8];
+        int msg_len = ts.bin_pub_can(start_pos, PUB_CAN, 1, msg_id, msg_data);
+        if (msg_len <= 0) {
+            msg_len = ts.bin_pub_can(start_pos, PUB_CAN, 1, msg_id, msg_data);
+        }
+        return msg_len;
+    });
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            json_output = true;
+        }
+        else if (strcmp(argv[i], "--min-time-ms") == 0 && i + 1 < argc) {
+            min_time_ms = atoi(argv[++i]);
+        }
+        else {
+            fprintf(stderr, "Usage: %s [--json] [--min-time-ms <ms>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (!json_output) {
+        printf("%-14s %8s %12s %10s %14s\n", "benchmark", "size", "ns/request", "bytes",
+            "bytes/s");
+    }
+
+    for (unsigned int i = 0; i < sizeof(tree_sizes) / sizeof(tree_sizes[0]); i++) {
+        bench_tree(tree_sizes[i]);
+    }
+
+    bench_json();
+    bench_arrays();
+    bench_jsmn();
+
+    return 0;
+}
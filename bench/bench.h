@@ -0,0 +1,87 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <chrono>
+
+/*
+ * Print results as JSON objects (one per line) instead of a table
+ */
+extern bool json_output;
+
+/*
+ * Minimum time for each benchmark
+ */
+extern unsigned int min_time_ms;
+
+/*
+ * Runs the function until min_time_ms has passed and prints the result
+ *
+ * The function has to return the number of bytes generated in one run (0 for lookups) or a
+ * negative value in case of an error. The size is the number of data nodes or the number of
+ * elements processed in each run.
+ */
+template<typename F>
+static void run(const char *bench, size_t size, F fun)
+{
+    typedef std::chrono::steady_clock clock;
+
+    int bytes = fun();      // warm-up and sanity check
+    if (bytes < 0) {
+        fprintf(stderr, "Benchmark %s with size %d failed\n", bench, (int)size);
+        exit(1);
+    }
+
+    unsigned long iterations = 0;
+    unsigned long batch = 16;
+    uint64_t total_bytes = 0;
+    clock::duration elapsed;
+    clock::time_point start = clock::now();
+    do {
+        for (unsigned long i = 0; i < batch; i++) {
+            total_bytes += fun();
+        }
+        iterations += batch;
+        batch *= 2;
+        elapsed = clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(min_time_ms));
+
+    double ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    double ns_per_req = ns / iterations;
+    double bytes_per_s = total_bytes * 1e9 / ns;
+
+    if (json_output) {
+        printf("{\"bench\":\"%s\",\"size\":%d,\"iterations\":%lu,\"bytes\":%d,"
+            "\"ns_per_req\":%.1f,\"bytes_per_s\":%.0f}\n",
+            bench, (int)size, iterations, bytes, ns_per_req, bytes_per_s);
+    }
+    else {
+        printf("%-14s %8d %12.1f %10d %14.0f\n",
+            bench, (int)size, ns_per_req, bytes, bytes_per_s);
+    }
+}
+
+/*
+ * Benchmarks of the JSON formatting functions
+ */
+void bench_json();
+
+/*
+ * Benchmarks of the bulk serialization of numeric arrays
+ */
+void bench_arrays();
+
+/*
+ * Benchmarks of the JSON parser
+ */
+void bench_jsmn();
+
+#endif /* BENCH_H_ */
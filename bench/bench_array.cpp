@@ -0,0 +1,129 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+/*
+ * Benchmarks of the bulk serialization of numeric arrays compared to serializing each element
+ * separately (as done for all arrays before)
+ */
+
+#include "bench.h"
+
+#include "json.h"
+#include "cbor.h"
+
+static const size_t array_sizes[] = { 16, 64, 256, 1024, 4096 };
+
+#define MAX_ELEMENTS    4096
+
+static int json_int16_single(char *buf, size_t size, const int16_t *values, size_t num)
+{
+    size_t pos = 1;
+    buf[0] = '[';
+    for (size_t i = 0; i < num; i++) {
+        int len = json_serialize_int32(&buf[pos], values[i], size - pos);
+        if (len == 0 || pos + len + 1 >= size) {
+            return -1;
+        }
+        pos += len;
+        buf[pos++] = ',';
+    }
+    buf[pos - 1] = ']';
+    return pos;
+}
+
+static int json_float_single(char *buf, size_t size, const float *values, size_t num)
+{
+    size_t pos = 1;
+    buf[0] = '[';
+    for (size_t i = 0; i < num; i++) {
+        int len = json_serialize_float(&buf[pos], values[i], 2, size - pos);
+        if (len == 0 || pos + len + 1 >= size) {
+            return -1;
+        }
+        pos += len;
+        buf[pos++] = ',';
+    }
+    buf[pos - 1] = ']';
+    return pos;
+}
+
+static int cbor_int16_single(uint8_t *buf, size_t size, const int16_t *values, size_t num)
+{
+    size_t pos = cbor_serialize_array(buf, num, size);
+    for (size_t i = 0; i < num; i++) {
+        int len = cbor_serialize_int(&buf[pos], values[i], size - pos);
+        if (len == 0) {
+            return -1;
+        }
+        pos += len;
+    }
+    return pos;
+}
+
+static int cbor_float_single(uint8_t *buf, size_t size, const float *values, size_t num)
+{
+    size_t pos = cbor_serialize_array(buf, num, size);
+    for (size_t i = 0; i < num; i++) {
+        int len = cbor_serialize_float(&buf[pos], values[i], size - pos);
+        if (len == 0) {
+            return -1;
+        }
+        pos += len;
+    }
+    return pos;
+}
+
+void bench_arrays()
+{
+    // waveform-like data (mix of small and large values)
+    static int16_t int16_values[MAX_ELEMENTS];
+    static float float_values[MAX_ELEMENTS];
+    static char json_buf[MAX_ELEMENTS * 70];
+    static uint8_t cbor_buf[MAX_ELEMENTS * 5 + 5];
+
+    uint32_t rand_state = 12345;
+    for (unsigned int i = 0; i < MAX_ELEMENTS; i++) {
+        rand_state = rand_state * 1103515245 + 12345;
+        int16_values[i] = (int16_t)(rand_state >> 16) >> (rand_state % 12);
+        float_values[i] = int16_values[i] / 100.0F;
+    }
+
+    for (unsigned int i = 0; i < sizeof(array_sizes) / sizeof(array_sizes[0]); i++) {
+        size_t num = array_sizes[i];
+
+        run("i16_json_elem", num, [&]() {
+            return json_int16_single(json_buf, sizeof(json_buf), int16_values, num);
+        });
+
+        run("i16_json_bulk", num, [&]() {
+            return json_serialize_array_int16(json_buf, int16_values, num, sizeof(json_buf));
+        });
+
+        run("f32_json_elem", num, [&]() {
+            return json_float_single(json_buf, sizeof(json_buf), float_values, num);
+        });
+
+        run("f32_json_bulk", num, [&]() {
+            return json_serialize_array_float(json_buf, float_values, num, 2, sizeof(json_buf));
+        });
+
+        run("i16_cbor_elem", num, [&]() {
+            return cbor_int16_single(cbor_buf, sizeof(cbor_buf), int16_values, num);
+        });
+
+        run("i16_cbor_bulk", num, [&]() {
+            return cbor_serialize_array_int16(cbor_buf, int16_values, num, sizeof(cbor_buf));
+        });
+
+        run("f32_cbor_elem", num, [&]() {
+            return cbor_float_single(cbor_buf, sizeof(cbor_buf), float_values, num);
+        });
+
+        run("f32_cbor_bulk", num, [&]() {
+            return cbor_serialize_array_float(cbor_buf, float_values, num, sizeof(cbor_buf));
+        });
+    }
+}
@@ -0,0 +1,107 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+/*
+ * Benchmarks of the JSON parser with typical payloads of text mode requests
+ *
+ * Build with TS_32BIT_JSON_OFFSETS = 1 to compare the 16-bit and 32-bit token layout and with
+ * TS_JSON_SIMD_SCAN = 0 to compare with the byte-wise scanning of strings and numbers.
+ */
+
+#include "bench.h"
+
+#include "jsmn.h"
+
+#include <string.h>
+
+static const size_t payload_sizes[] = { 16, 256, 2048, 16384 };
+
+#define MAX_ELEMENTS    16384
+
+/*
+ * Array of numbers, e.g. a calibration table
+ */
+static size_t payload_numbers(char *buf, size_t size, size_t num)
+{
+    size_t pos = snprintf(buf, size, "[");
+    for (size_t i = 0; i < num && pos < size; i++) {
+        pos += snprintf(&buf[pos], size - pos, "%s%d.%02d", i > 0 ? "," : "",
+            (int)(i * 37 % 10000), (int)(i % 100));
+    }
+    pos += snprintf(&buf[pos], size - pos, "]");
+    return pos;
+}
+
+/*
+ * Map with node names and values, e.g. a PATCH request
+ */
+static size_t payload_object(char *buf, size_t size, size_t num)
+{
+    size_t pos = snprintf(buf, size, "{");
+    for (size_t i = 0; i < num && pos < size; i++) {
+        pos += snprintf(&buf[pos], size - pos, "%s\"Node%d_V\":%d", i > 0 ? "," : "",
+            (int)i, (int)(i * 37 % 10000));
+    }
+    pos += snprintf(&buf[pos], size - pos, "}");
+    return pos;
+}
+
+/*
+ * Map with string values, e.g. a PATCH request with device information from a gateway
+ */
+static size_t payload_strings(char *buf, size_t size, size_t num)
+{
+    size_t pos = snprintf(buf, size, "{");
+    for (size_t i = 0; i < num && pos < size; i++) {
+        pos += snprintf(&buf[pos], size - pos, "%s\"Device%d_Info\":\"LibreSolar MPPT 2420 HC "
+            "v0.10.1 (ID 0x%08X)\"", i > 0 ? "," : "", (int)i, (unsigned int)(i * 2654435761U));
+    }
+    pos += snprintf(&buf[pos], size - pos, "}");
+    return pos;
+}
+
+static void bench_payload(const char *bench, size_t num, char *js, size_t len, jsmntok_t *tokens)
+{
+    if (len > JSMN_MAX_LEN) {
+        return;     // not supported with 16-bit offsets
+    }
+    run(bench, num, [&]() {
+        jsmn_parser parser;
+        jsmn_init(&parser);
+        int count = jsmn_parse(&parser, js, len, tokens, MAX_ELEMENTS * 2 + 1);
+        return count > 0 ? (int)len : -1;
+    });
+}
+
+void bench_jsmn()
+{
+    static char js[MAX_ELEMENTS * 72];
+    static jsmntok_t tokens[MAX_ELEMENTS * 2 + 1];
+
+    if (!json_output) {
+        printf("jsmn with %d-bit offsets, %d bytes per token, %s scanning\n",
+            (int)sizeof(jsmn_offset_t) * 8, (int)sizeof(jsmntok_t),
+            TS_JSON_SIMD_SCAN ? "block-wise" : "byte-wise");
+    }
+
+    for (size_t i = 0; i < sizeof(payload_sizes) / sizeof(payload_sizes[0]); i++) {
+        size_t num = payload_sizes[i];
+        size_t len = payload_numbers(js, sizeof(js), num);
+        bench_payload("jsmn_numbers", num, js, len, tokens);
+    }
+
+    for (size_t i = 0; i < sizeof(payload_sizes) / sizeof(payload_sizes[0]); i++) {
+        size_t num = payload_sizes[i];
+        size_t len = payload_object(js, sizeof(js), num);
+        bench_payload("jsmn_object", num, js, len, tokens);
+    }
+
+    for (size_t i = 0; i < sizeof(payload_sizes) / sizeof(payload_sizes[0]); i++) {
+        size_t num = payload_sizes[i];
+        size_t len = payload_strings(js, sizeof(js), num);
+        bench_payload("jsmn_strings", num, js, len, tokens);
+    }
+}
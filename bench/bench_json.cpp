@@ -0,0 +1,149 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+/*
+ * Benchmarks of the JSON value formatting and parsing compared to snprintf and strtod/strtol
+ */
+
+#include "bench.h"
+
+#include "json.h"
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_VALUES      1024    // number of different values used in each benchmark
+
+/*
+ * Straightforward escaping with one branch per character for comparison
+ */
+static int escape_bytewise(char *buf, const char *str, size_t len, size_t size)
+{
+    size_t pos = 0;
+    buf[pos++] = '"';
+    for (size_t i = 0; i < len; i++) {
+        if (pos + 8 > size) {
+            return -1;
+        }
+        char c = str[i];
+        if (c == '"' || c == '\\') {
+            buf[pos++] = '\\';
+            buf[pos++] = c;
+        }
+        else if ((uint8_t)c < 0x20) {
+            pos += snprintf(&buf[pos], size - pos, "\\u%04x", c);
+        }
+        else {
+            buf[pos++] = c;
+        }
+    }
+    buf[pos++] = '"';
+    buf[pos] = '\0';
+    return pos;
+}
+
+void bench_json()
+{
+    static int32_t int_values[NUM_VALUES];
+    static float float_values[NUM_VALUES];
+    char buf[50];
+    unsigned int i = 0;
+
+    uint32_t rand_state = 12345;
+    for (unsigned int n = 0; n < NUM_VALUES; n++) {
+        rand_state = rand_state * 1103515245 + 12345;
+        // mix of small and large numbers, as typically found in data nodes
+        int_values[n] = (int32_t)rand_state >> (rand_state % 24);
+        float_values[n] = int_values[n] / 100.0F;
+    }
+
+    run("int32_snprintf", 1, [&]() {
+        i = (i + 1) % NUM_VALUES;
+        return snprintf(buf, sizeof(buf), "%" PRIi32, int_values[i]);
+    });
+
+    run("int32_json", 1, [&]() {
+        i = (i + 1) % NUM_VALUES;
+        return json_serialize_int32(buf, int_values[i], sizeof(buf));
+    });
+
+    // typical device ID or firmware version string without special characters
+    const char *str = "LibreSolar MPPT 2420 HC v0.10.1 (ID 0x12AB34CD56EF7890)";
+    char str_buf[150];
+
+    run("str_bytewise", strlen(str), [&]() {
+        return escape_bytewise(str_buf, str, strlen(str), sizeof(str_buf));
+    });
+
+    run("str_json", strlen(str), [&]() {
+        return json_serialize_string(str_buf, str, strlen(str), sizeof(str_buf));
+    });
+
+    run("float_snprintf", 1, [&]() {
+        i = (i + 1) % NUM_VALUES;
+        return snprintf(buf, sizeof(buf), "%.*f", 2, float_values[i]);
+    });
+
+    run("float_json", 1, [&]() {
+        i = (i + 1) % NUM_VALUES;
+        return json_serialize_float(buf, float_values[i], 2, sizeof(buf));
+    });
+
+    run("float_printf_g", 1, [&]() {
+        i = (i + 1) % NUM_VALUES;
+        return snprintf(buf, sizeof(buf), "%.9g", float_values[i]);
+    });
+
+    run("float_shortest", 1, [&]() {
+        i = (i + 1) % NUM_VALUES;
+        return json_serialize_float(buf, float_values[i], JSON_FLOAT_SHORTEST, sizeof(buf));
+    });
+
+    // parsing of the values as found in text mode requests (no null termination)
+    static char int_strings[NUM_VALUES][12];
+    static char float_strings[NUM_VALUES][16];
+    for (unsigned int n = 0; n < NUM_VALUES; n++) {
+        json_serialize_int32(int_strings[n], int_values[n], sizeof(int_strings[n]));
+        json_serialize_float(float_strings[n], float_values[n], JSON_FLOAT_SHORTEST,
+            sizeof(float_strings[n]));
+    }
+
+    run("int32_strtol", 1, [&]() {
+        i = (i + 1) % NUM_VALUES;
+        // strtol needs a null-terminated copy of the token
+        size_t len = strlen(int_strings[i]);
+        memcpy(buf, int_strings[i], len + 1);
+        char *end;
+        long value = strtol(buf, &end, 0);
+        return (end == buf + len && value >= INT32_MIN && value <= INT32_MAX) ? 0 : -1;
+    });
+
+    run("int32_parse", 1, [&]() {
+        i = (i + 1) % NUM_VALUES;
+        int64_t value;
+        size_t len = strlen(int_strings[i]);
+        return json_deserialize_int64(int_strings[i], len, INT32_MIN, INT32_MAX, &value) == (int)len
+            ? 0 : -1;
+    });
+
+    run("float_strtod", 1, [&]() {
+        i = (i + 1) % NUM_VALUES;
+        size_t len = strlen(float_strings[i]);
+        memcpy(buf, float_strings[i], len + 1);
+        char *end;
+        volatile float value = strtod(buf, &end);
+        (void)value;
+        return end == buf + len ? 0 : -1;
+    });
+
+    run("float_parse", 1, [&]() {
+        i = (i + 1) % NUM_VALUES;
+        float value;
+        size_t len = strlen(float_strings[i]);
+        return json_deserialize_float(float_strings[i], len, &value) == (int)len ? 0 : -1;
+    });
+}
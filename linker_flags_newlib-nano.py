@@ -10,7 +10,6 @@ Import("env")
 
 env.Append(
     LINKFLAGS=[
-        "-Wl,-u,_printf_float",
         "--specs=nano.specs",
         "--specs=nosys.specs"
     ]
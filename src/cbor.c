@@ -11,59 +11,104 @@
 #include <stdbool.h>
 #include <string.h>
 
+/*
+ * Stores a 32-bit value in network byte order (a single byte swap instruction on little-endian
+ * targets supported by GCC and Clang)
+ */
+static void _write_be32(uint8_t *data, uint32_t value)
+{
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    value = __builtin_bswap32(value);
+    memcpy(data, &value, sizeof(value));
+#else
+    data[0] = value >> 24;
+    data[1] = value >> 16;
+    data[2] = value >> 8;
+    data[3] = value;
+#endif
+}
+
+/*
+ * Serializes the initial byte(s) of a data item with given major type and argument (the value of
+ * integers or the length of strings and containers)
+ *
+ * If data is NULL, only the number of bytes is calculated. This is used by all serialize
+ * functions, so that the measured length always matches the actual encoding.
+ */
 #ifdef TS_64BIT_TYPES_SUPPORT
-int cbor_serialize_uint(uint8_t *data, uint64_t value, size_t max_len)
+static int _serialize_type_arg(uint8_t *data, uint8_t type, uint64_t arg, size_t max_len)
 #else
-int cbor_serialize_uint(uint8_t *data, uint32_t value, size_t max_len)
+static int _serialize_type_arg(uint8_t *data, uint8_t type, uint32_t arg, size_t max_len)
 #endif
 {
-    if (max_len < 1) {
-        return 0;   // error
+    int len;
+    if (arg <= CBOR_NUM_MAX) {
+        len = 1;
     }
-    else if (value <= CBOR_NUM_MAX) {
-        data[0] = CBOR_UINT | (uint8_t)value;
-        //printf("serialize: value = %.2X <= CBOR_NUM_MAX, data: %.2X\n", (uint32_t)value, data[0]);
-        return 1;
+    else if (arg <= UINT8_MAX) {
+        len = 2;
     }
-    else if (value <= UINT8_MAX && max_len >= 2) {
-        data[0] = CBOR_UINT | CBOR_UINT8_FOLLOWS;
-        data[1] = value;
-        //printf("serialize: value = 0x%.2X < 0xFF, data: %.2X %.2X\n", (uint32_t)value, data[0], data[1]);
-        return 2;
+    else if (arg <= UINT16_MAX) {
+        len = 3;
     }
-    else if (value <= UINT16_MAX && max_len >= 3) {
-        data[0] = CBOR_UINT | CBOR_UINT16_FOLLOWS;
-        data[1] = value >> 8;
-        data[2] = value;
-        //printf("serialize: value = 0x%.4X <= 0xFFFF, data: %.2X %.2X %.2X\n", (uint32_t)value, data[0], data[1], data[2]);
-        return 3;
+    else if (arg <= UINT32_MAX) {
+        len = 5;
     }
-    else if (value <= UINT32_MAX && max_len >= 5) {
-        data[0] = CBOR_UINT | CBOR_UINT32_FOLLOWS;
-        data[1] = value >> 24;
-        data[2] = value >> 16;
-        data[3] = value >> 8;
-        data[4] = value;
-        //printf("serialize: value = 0x%.8X <= 0xFFFFFFFF, data: %.2X %.2X %.2X %.2X %.2X\n", (uint32_t)value, data[0], data[1], data[2], data[3], data[4]);
-        return 5;
+    else {
+        len = 9;
     }
-#ifdef TS_64BIT_TYPES_SUPPORT
-    else if (max_len >= 9) {
-        data[0] = CBOR_UINT | CBOR_UINT64_FOLLOWS;
-        data[1] = (value >> 32) >> 24;
-        data[2] = (value >> 32) >> 16;
-        data[3] = (value >> 32) >> 8;
-        data[4] = (value >> 32);
-        data[5] = value >> 24;
-        data[6] = value >> 16;
-        data[7] = value >> 8;
-        data[8] = value;
-        return 9;
+
+    if (data == NULL) {
+        return len;
     }
-#endif
-    else {
+    else if (max_len < (size_t)len) {
         return 0;
     }
+
+    switch (len) {
+        case 1:
+            data[0] = type | (uint8_t)arg;
+            break;
+        case 2:
+            data[0] = type | CBOR_UINT8_FOLLOWS;
+            data[1] = arg;
+            break;
+        case 3:
+            data[0] = type | CBOR_UINT16_FOLLOWS;
+            data[1] = arg >> 8;
+            data[2] = arg;
+            break;
+        case 5:
+            data[0] = type | CBOR_UINT32_FOLLOWS;
+            data[1] = arg >> 24;
+            data[2] = arg >> 16;
+            data[3] = arg >> 8;
+            data[4] = arg;
+            break;
+#ifdef TS_64BIT_TYPES_SUPPORT
+        default:
+            data[0] = type | CBOR_UINT64_FOLLOWS;
+            data[1] = (arg >> 32) >> 24;
+            data[2] = (arg >> 32) >> 16;
+            data[3] = (arg >> 32) >> 8;
+            data[4] = (arg >> 32);
+            data[5] = arg >> 24;
+            data[6] = arg >> 16;
+            data[7] = arg >> 8;
+            data[8] = arg;
+            break;
+#endif
+    }
+    return len;
+}
+
+#ifdef TS_64BIT_TYPES_SUPPORT
+int cbor_serialize_uint(uint8_t *data, uint64_t value, size_t max_len)
+#else
+int cbor_serialize_uint(uint8_t *data, uint32_t value, size_t max_len)
+#endif
+{
+    return _serialize_type_arg(data, CBOR_UINT, value, max_len);
 }
 
 #ifdef TS_64BIT_TYPES_SUPPORT
@@ -72,131 +117,220 @@ int cbor_serialize_int(uint8_t *data, int64_t value, size_t max_len)
 int cbor_serialize_int(uint8_t *data, int32_t value, size_t max_len)
 #endif
 {
-    if (max_len < 1) {
-        return 0;
-    }
-
     if (value >= 0) {
-        return cbor_serialize_uint(data, value, max_len);
-    } else {
-        int size = cbor_serialize_uint(data, -1 - value, max_len);
-        data[0] |= CBOR_NEGINT;    // set major type 1 for negative integer
-        return size;
+        return _serialize_type_arg(data, CBOR_UINT, value, max_len);
+    }
+    else {
+        return _serialize_type_arg(data, CBOR_NEGINT, -1 - value, max_len);
     }
 }
 
 int cbor_serialize_float(uint8_t *data, float value, size_t max_len)
 {
-    if (max_len < 5)
+    if (data == NULL) {
+        return 5;
+    }
+    else if (max_len < 5) {
         return 0;
+    }
 
     data[0] = CBOR_FLOAT32;
 
     union { float f; uint32_t ui; } f2ui;
     f2ui.f = value;
-    data[1] = f2ui.ui >> 24;
-    data[2] = f2ui.ui >> 16;
-    data[3] = f2ui.ui >> 8;
-    data[4] = f2ui.ui;
+    _write_be32(&data[1], f2ui.ui);
 
     return 5;
 }
 
 int cbor_serialize_bool(uint8_t *data, bool value, size_t max_len)
 {
-    if (max_len < 1)
+    if (data == NULL) {
+        return 1;
+    }
+    else if (max_len < 1) {
         return 0;
+    }
 
     data[0] = value ? CBOR_TRUE : CBOR_FALSE;
     return 1;
 }
 
-int cbor_serialize_string(uint8_t *data, const char *value, size_t max_len)
+/*
+ * Serializes a byte or text string with header and content
+ */
+static int _serialize_string(uint8_t *data, uint8_t type, const void *content, size_t len,
+    size_t max_len)
 {
-    unsigned int len = strlen(value);
-
-    //printf("serialize string: \"%s\", len = %d, max_len = %d\n", value, len, max_len);
-
-    if (len <= CBOR_NUM_MAX && len + 1 <= max_len) {
-        data[0] = CBOR_TEXT | (uint8_t)len;
-        strcpy((char*)&data[1], value);
-        return len + 1;
-    }
-    else if (len < UINT8_MAX && len + 2 <= max_len) {
-        data[0] = CBOR_TEXT | CBOR_UINT8_FOLLOWS;
-        data[1] = (uint8_t)len;
-        strcpy((char*)&data[2], value);
-        return len + 2;
+    int len_header = _serialize_type_arg(data, type, len, max_len);
+    if (data == NULL) {
+        return len_header + len;
     }
-    else if (len < UINT16_MAX && len + 3 <= max_len) {
-        data[0] = CBOR_TEXT | CBOR_UINT16_FOLLOWS;
-        data[1] = (uint16_t)len >> 8;
-        data[2] = (uint16_t)len;
-        strcpy((char*)&data[3], value);
-        return len + 3;
-    }
-    else {    // string too long (more than 65535 characters)
+    else if (len_header == 0 || len_header + len > max_len) {
         return 0;
     }
+    memcpy(&data[len_header], content, len);
+    return len_header + len;
+}
+
+int cbor_serialize_string(uint8_t *data, const char *value, size_t max_len)
+{
+    return _serialize_string(data, CBOR_TEXT, value, strlen(value), max_len);
+}
+
+int cbor_serialize_string_len(uint8_t *data, const char *value, size_t len, size_t max_len)
+{
+    return _serialize_string(data, CBOR_TEXT, value, len, max_len);
 }
 
 int cbor_serialize_bytes(uint8_t *data, const uint8_t *bytes, size_t num_bytes, size_t max_len)
 {
-    if (num_bytes <= CBOR_NUM_MAX && num_bytes + 1 <= max_len) {
-        data[0] = CBOR_BYTES | (uint8_t)num_bytes;
-        memcpy(&data[1], bytes, num_bytes);
-        return num_bytes + 1;
-    }
-    else if (num_bytes < UINT8_MAX && num_bytes + 2 <= max_len) {
-        data[0] = CBOR_BYTES | CBOR_UINT8_FOLLOWS;
-        data[1] = (uint8_t)num_bytes;
-        memcpy((char*)&data[2], bytes, num_bytes);
-        return num_bytes + 2;
-    }
-    else if (num_bytes < UINT16_MAX && num_bytes + 3 <= max_len) {
-        data[0] = CBOR_BYTES | CBOR_UINT16_FOLLOWS;
-        data[1] = (uint16_t)num_bytes >> 8;
-        data[2] = (uint16_t)num_bytes;
-        memcpy((char*)&data[3], bytes, num_bytes);
-        return num_bytes + 3;
-    }
-    else {    // too many bytes (more than 65535)
-        return 0;
-    }
+    return _serialize_string(data, CBOR_BYTES, bytes, num_bytes, max_len);
+}
+
+int cbor_serialize_map(uint8_t *data, size_t num_elements, size_t max_len)
+{
+    return _serialize_type_arg(data, CBOR_MAP, num_elements, max_len);
+}
+
+int cbor_serialize_array(uint8_t *data, size_t num_elements, size_t max_len)
+{
+    return _serialize_type_arg(data, CBOR_ARRAY, num_elements, max_len);
 }
 
-int _serialize_num_elements(uint8_t *data, size_t num_elements, size_t max_len)
+/*
+ * Writes a data item with up to 32-bit argument without bounds check (max. 5 bytes)
+ */
+static int _write_type_arg32(uint8_t *data, uint8_t type, uint32_t arg)
 {
-    if (num_elements <= CBOR_NUM_MAX && max_len > 0) {
-        data[0] |= (uint8_t)num_elements;
+    if (arg <= CBOR_NUM_MAX) {
+        data[0] = type | (uint8_t)arg;
         return 1;
     }
-    else if (num_elements < UINT8_MAX && max_len > 1) {
-        data[0] |= CBOR_UINT8_FOLLOWS;
-        data[1] = (uint8_t)num_elements;
+    else if (arg <= UINT8_MAX) {
+        data[0] = type | CBOR_UINT8_FOLLOWS;
+        data[1] = arg;
         return 2;
     }
-    else if (num_elements < UINT16_MAX && max_len > 1) {
-        data[0] |= CBOR_UINT16_FOLLOWS;
-        data[1] = (uint16_t)num_elements >> 8;
-        data[2] = (uint16_t)num_elements;
+    else if (arg <= UINT16_MAX) {
+        data[0] = type | CBOR_UINT16_FOLLOWS;
+        data[1] = arg >> 8;
+        data[2] = arg;
         return 3;
     }
-    else {    // too many elements (more than 65535)
-        return 0;
+    else {
+        data[0] = type | CBOR_UINT32_FOLLOWS;
+        _write_be32(&data[1], arg);
+        return 5;
     }
 }
 
-int cbor_serialize_map(uint8_t *data, size_t num_elements, size_t max_len)
+/*
+ * Writes a signed integer without bounds check (max. 5 bytes)
+ *
+ * Negative values are encoded as -1 - value, which is the bitwise complement, so the major type
+ * and the argument are determined with a mask instead of a branch.
+ */
+static int _write_int32(uint8_t *data, int32_t value)
 {
-    data[0] = CBOR_MAP;
-    return _serialize_num_elements(data, num_elements, max_len);
+    uint32_t sign = 0U - (uint32_t)(value < 0);
+    return _write_type_arg32(data, CBOR_UINT | (sign & CBOR_NEGINT), (uint32_t)value ^ sign);
 }
 
-int cbor_serialize_array(uint8_t *data, size_t num_elements, size_t max_len)
+static uint8_t *_offset(uint8_t *data, size_t pos)
+{
+    return (data == NULL) ? NULL : &data[pos];
+}
+
+/*
+ * The bulk serialization functions for integer arrays write the elements without bounds check as
+ * long as the remaining space is sufficient for the largest possible element and fall back to the
+ * checked functions close to the end of the buffer (and for measuring with data == NULL).
+ */
+
+int cbor_serialize_array_uint16(uint8_t *data, const uint16_t *values, size_t num_elements,
+    size_t max_len)
+{
+    size_t pos = cbor_serialize_array(data, num_elements, max_len);
+    for (size_t i = 0; i < num_elements && pos > 0; i++) {
+        if (data != NULL && max_len - pos >= 3) {
+            pos += _write_type_arg32(&data[pos], CBOR_UINT, values[i]);
+        }
+        else {
+            int len = cbor_serialize_uint(_offset(data, pos), values[i], max_len - pos);
+            pos = (len > 0) ? pos + len : 0;
+        }
+    }
+    return pos;
+}
+
+int cbor_serialize_array_int16(uint8_t *data, const int16_t *values, size_t num_elements,
+    size_t max_len)
+{
+    size_t pos = cbor_serialize_array(data, num_elements, max_len);
+    for (size_t i = 0; i < num_elements && pos > 0; i++) {
+        if (data != NULL && max_len - pos >= 3) {
+            pos += _write_int32(&data[pos], values[i]);
+        }
+        else {
+            int len = cbor_serialize_int(_offset(data, pos), values[i], max_len - pos);
+            pos = (len > 0) ? pos + len : 0;
+        }
+    }
+    return pos;
+}
+
+int cbor_serialize_array_uint32(uint8_t *data, const uint32_t *values, size_t num_elements,
+    size_t max_len)
 {
-    data[0] = CBOR_ARRAY;
-    return _serialize_num_elements(data, num_elements, max_len);
+    size_t pos = cbor_serialize_array(data, num_elements, max_len);
+    for (size_t i = 0; i < num_elements && pos > 0; i++) {
+        if (data != NULL && max_len - pos >= 5) {
+            pos += _write_type_arg32(&data[pos], CBOR_UINT, values[i]);
+        }
+        else {
+            int len = cbor_serialize_uint(_offset(data, pos), values[i], max_len - pos);
+            pos = (len > 0) ? pos + len : 0;
+        }
+    }
+    return pos;
+}
+
+int cbor_serialize_array_int32(uint8_t *data, const int32_t *values, size_t num_elements,
+    size_t max_len)
+{
+    size_t pos = cbor_serialize_array(data, num_elements, max_len);
+    for (size_t i = 0; i < num_elements && pos > 0; i++) {
+        if (data != NULL && max_len - pos >= 5) {
+            pos += _write_int32(&data[pos], values[i]);
+        }
+        else {
+            int len = cbor_serialize_int(_offset(data, pos), values[i], max_len - pos);
+            pos = (len > 0) ? pos + len : 0;
+        }
+    }
+    return pos;
+}
+
+int cbor_serialize_array_float(uint8_t *data, const float *values, size_t num_elements,
+    size_t max_len)
+{
+    size_t pos = cbor_serialize_array(data, num_elements, max_len);
+    if (data == NULL) {
+        return pos + num_elements * 5;
+    }
+    else if (pos == 0 || max_len - pos < num_elements * 5) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < num_elements; i++) {
+        uint32_t bits;
+        memcpy(&bits, &values[i], sizeof(bits));
+        data[pos] = CBOR_FLOAT32;
+        _write_be32(&data[pos + 1], bits);
+        pos += 5;
+    }
+    return pos;
 }
 
 #ifdef TS_64BIT_TYPES_SUPPORT
@@ -57,6 +57,12 @@ extern "C" {
 #define CBOR_FLOAT64    (CBOR_7 | 27)
 #define CBOR_BREAK      (CBOR_7 | 31)
 
+/*
+ * If data is NULL, the serialize functions don't write anything and return the number of bytes
+ * the encoded value would need (max_len is ignored in this case). This can be used to measure
+ * the exact length of a message before it is generated.
+ */
+
 /**
  * Serialize unsigned integer value
  *
@@ -134,6 +140,18 @@ int cbor_serialize_bool(uint8_t *data, bool value, size_t max_len);
  */
 int cbor_serialize_string(uint8_t *data, const char *value, size_t max_len);
 
+/**
+ * Serialize string with known length (no null termination required)
+ *
+ * @param data Buffer where CBOR data shall be stored
+ * @param value Pointer to string that should be be serialized
+ * @param len Length of the string
+ * @param max_len Maximum remaining space in buffer (i.e. max length of serialized data)
+ *
+ * @returns Number of bytes added to buffer or 0 in case of error
+ */
+int cbor_serialize_string_len(uint8_t *data, const char *value, size_t len, size_t max_len);
+
 /**
  * Serialize bytes
  *
@@ -172,6 +190,78 @@ int cbor_serialize_array(uint8_t *data, size_t num_elements, size_t max_len);
  */
 int cbor_serialize_map(uint8_t *data, size_t num_elements, size_t max_len);
 
+/*
+ * Bulk serialization of numeric arrays
+ *
+ * Same result as serializing the array header and each element separately, but without the
+ * overhead of a function call and bounds check per element.
+ */
+
+/**
+ * Serialize array of 16-bit unsigned integers (including the array header)
+ *
+ * @param data Buffer where CBOR data shall be stored
+ * @param values Pointer to the first element of the array
+ * @param num_elements Number of elements to be serialized
+ * @param max_len Maximum remaining space in buffer (i.e. max length of serialized data)
+ *
+ * @returns Number of bytes added to buffer or 0 in case of error
+ */
+int cbor_serialize_array_uint16(uint8_t *data, const uint16_t *values, size_t num_elements,
+    size_t max_len);
+
+/**
+ * Serialize array of 16-bit signed integers (including the array header)
+ *
+ * @param data Buffer where CBOR data shall be stored
+ * @param values Pointer to the first element of the array
+ * @param num_elements Number of elements to be serialized
+ * @param max_len Maximum remaining space in buffer (i.e. max length of serialized data)
+ *
+ * @returns Number of bytes added to buffer or 0 in case of error
+ */
+int cbor_serialize_array_int16(uint8_t *data, const int16_t *values, size_t num_elements,
+    size_t max_len);
+
+/**
+ * Serialize array of 32-bit unsigned integers (including the array header)
+ *
+ * @param data Buffer where CBOR data shall be stored
+ * @param values Pointer to the first element of the array
+ * @param num_elements Number of elements to be serialized
+ * @param max_len Maximum remaining space in buffer (i.e. max length of serialized data)
+ *
+ * @returns Number of bytes added to buffer or 0 in case of error
+ */
+int cbor_serialize_array_uint32(uint8_t *data, const uint32_t *values, size_t num_elements,
+    size_t max_len);
+
+/**
+ * Serialize array of 32-bit signed integers (including the array header)
+ *
+ * @param data Buffer where CBOR data shall be stored
+ * @param values Pointer to the first element of the array
+ * @param num_elements Number of elements to be serialized
+ * @param max_len Maximum remaining space in buffer (i.e. max length of serialized data)
+ *
+ * @returns Number of bytes added to buffer or 0 in case of error
+ */
+int cbor_serialize_array_int32(uint8_t *data, const int32_t *values, size_t num_elements,
+    size_t max_len);
+
+/**
+ * Serialize array of 32-bit floats (including the array header)
+ *
+ * @param data Buffer where CBOR data shall be stored
+ * @param values Pointer to the first element of the array
+ * @param num_elements Number of elements to be serialized
+ * @param max_len Maximum remaining space in buffer (i.e. max length of serialized data)
+ *
+ * @returns Number of bytes added to buffer or 0 in case of error
+ */
+int cbor_serialize_array_float(uint8_t *data, const float *values, size_t num_elements,
+    size_t max_len);
+
 /**
  * Deserialization (CBOR data to C values)
  */
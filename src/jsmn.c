@@ -1,5 +1,158 @@
 #include "jsmn.h"
 
+#include <string.h>
+
+#if TS_JSON_SIMD_SCAN
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define JSMN_NEON
+#endif
+
+#define BYTES_ONES		0x0101010101010101ULL
+#define BYTES_HIGH_BITS	0x8080808080808080ULL
+
+/* high bit set in each byte of x that is below n (n <= 128), may have false positives
+ * only after the first match */
+#define BYTES_LESS(x, n)	(((x) - BYTES_ONES * (n)) & ~(x) & BYTES_HIGH_BITS)
+
+/* high bit set in each byte of x that is equal to c, same limitation as above */
+#define BYTES_EQUAL(x, c)	BYTES_LESS((x) ^ (BYTES_ONES * (c)), 1)
+
+#ifdef JSMN_NEON
+/**
+ * Returns index of the first non-zero byte in a NEON comparison result or 16 if none.
+ */
+static int jsmn_neon_first(uint8x16_t match) {
+	/* narrow each byte to 4 bits, as NEON has no movemask */
+	uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+		vshrn_n_u16(vreinterpretq_u16_u8(match), 4)), 0);
+	return mask == 0 ? 16 : __builtin_ctzll(mask) / 4;
+}
+#endif
+
+/**
+ * Returns position of the next character in a string that has to be checked by
+ * jsmn_parse_string (quote, backslash or null character), or len.
+ *
+ * Blocks of 8 to 32 bytes are skipped at once, depending on the target.
+ */
+static size_t jsmn_scan_string(const char *js, size_t pos, size_t len) {
+#if defined(__AVX2__)
+	for (; pos + 32 <= len; pos += 32) {
+		__m256i chars = _mm256_loadu_si256((const __m256i *)&js[pos]);
+		__m256i match = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(chars, _mm256_set1_epi8('\"')),
+				_mm256_cmpeq_epi8(chars, _mm256_set1_epi8('\\'))),
+			_mm256_cmpeq_epi8(chars, _mm256_setzero_si256()));
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(match);
+		if (mask != 0) {
+			return pos + __builtin_ctz(mask);
+		}
+	}
+#endif
+#if defined(__SSE2__)
+	for (; pos + 16 <= len; pos += 16) {
+		__m128i chars = _mm_loadu_si128((const __m128i *)&js[pos]);
+		__m128i match = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8('\"')),
+				_mm_cmpeq_epi8(chars, _mm_set1_epi8('\\'))),
+			_mm_cmpeq_epi8(chars, _mm_setzero_si128()));
+		int mask = _mm_movemask_epi8(match);
+		if (mask != 0) {
+			return pos + __builtin_ctz(mask);
+		}
+	}
+#elif defined(JSMN_NEON)
+	for (; pos + 16 <= len; pos += 16) {
+		uint8x16_t chars = vld1q_u8((const uint8_t *)&js[pos]);
+		uint8x16_t match = vorrq_u8(
+			vorrq_u8(vceqq_u8(chars, vdupq_n_u8('\"')), vceqq_u8(chars, vdupq_n_u8('\\'))),
+			vceqq_u8(chars, vdupq_n_u8(0)));
+		int first = jsmn_neon_first(match);
+		if (first < 16) {
+			return pos + first;
+		}
+	}
+#endif
+	for (; pos + 8 <= len; pos += 8) {
+		uint64_t word;
+		memcpy(&word, &js[pos], sizeof(word));
+		if ((BYTES_EQUAL(word, '\"') | BYTES_EQUAL(word, '\\') | BYTES_LESS(word, 1)) != 0) {
+			break;
+		}
+	}
+	while (pos < len && js[pos] != '\"' && js[pos] != '\\' && js[pos] != '\0') {
+		pos++;
+	}
+	return pos;
+}
+
+/**
+ * Checks if a character may end a primitive or is not allowed in a primitive
+ */
+static int jsmn_primitive_end(char c) {
+	return (unsigned char)c <= ' ' || (unsigned char)c >= 127 ||
+		c == ',' || c == ']' || c == '}' || c == ':';
+}
+
+/**
+ * Returns position of the next character in a primitive that has to be checked by
+ * jsmn_parse_primitive (delimiter, colon or invalid character), or len.
+ */
+static size_t jsmn_scan_primitive(const char *js, size_t pos, size_t len) {
+#if defined(__SSE2__)
+	for (; pos + 16 <= len; pos += 16) {
+		__m128i chars = _mm_loadu_si128((const __m128i *)&js[pos]);
+		/* signed comparison also matches all bytes >= 128 */
+		__m128i match = _mm_or_si128(
+			_mm_or_si128(_mm_cmplt_epi8(chars, _mm_set1_epi8(' ' + 1)),
+				_mm_cmpeq_epi8(chars, _mm_set1_epi8(127))),
+			_mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8(',')),
+					_mm_cmpeq_epi8(chars, _mm_set1_epi8(':'))),
+				_mm_or_si128(_mm_cmpeq_epi8(chars, _mm_set1_epi8(']')),
+					_mm_cmpeq_epi8(chars, _mm_set1_epi8('}')))));
+		int mask = _mm_movemask_epi8(match);
+		if (mask != 0) {
+			return pos + __builtin_ctz(mask);
+		}
+	}
+#elif defined(JSMN_NEON)
+	for (; pos + 16 <= len; pos += 16) {
+		uint8x16_t chars = vld1q_u8((const uint8_t *)&js[pos]);
+		uint8x16_t match = vorrq_u8(
+			vorrq_u8(vcleq_u8(chars, vdupq_n_u8(' ')), vcgeq_u8(chars, vdupq_n_u8(127))),
+			vorrq_u8(
+				vorrq_u8(vceqq_u8(chars, vdupq_n_u8(',')), vceqq_u8(chars, vdupq_n_u8(':'))),
+				vorrq_u8(vceqq_u8(chars, vdupq_n_u8(']')), vceqq_u8(chars, vdupq_n_u8('}')))));
+		int first = jsmn_neon_first(match);
+		if (first < 16) {
+			return pos + first;
+		}
+	}
+#endif
+	for (; pos + 8 <= len; pos += 8) {
+		uint64_t word;
+		memcpy(&word, &js[pos], sizeof(word));
+		if (((word & BYTES_HIGH_BITS) | BYTES_LESS(word, ' ' + 1) | BYTES_EQUAL(word, 127) |
+				BYTES_EQUAL(word, ',') | BYTES_EQUAL(word, ':') |
+				BYTES_EQUAL(word, ']') | BYTES_EQUAL(word, '}')) != 0) {
+			break;
+		}
+	}
+	while (pos < len && !jsmn_primitive_end(js[pos])) {
+		pos++;
+	}
+	return pos;
+}
+#endif /* TS_JSON_SIMD_SCAN */
+
 /**
  * Allocates a fresh unused token from the token pool.
  */
@@ -40,6 +193,13 @@ static int jsmn_parse_primitive(jsmn_parser *parser, const char *js,
 	start = parser->pos;
 
 	for (; parser->pos < len && js[parser->pos] != '\0'; parser->pos++) {
+#if TS_JSON_SIMD_SCAN
+		/* skip characters that can't end the primitive */
+		parser->pos = jsmn_scan_primitive(js, parser->pos, len);
+		if (parser->pos >= len || js[parser->pos] == '\0') {
+			break;
+		}
+#endif
 		switch (js[parser->pos]) {
 #ifndef JSMN_STRICT
 			/* In strict mode primitive must be followed by "," or "}" or "]" */
@@ -91,7 +251,15 @@ static int jsmn_parse_string(jsmn_parser *parser, const char *js,
 
 	/* Skip starting quote */
 	for (; parser->pos < len && js[parser->pos] != '\0'; parser->pos++) {
-		char c = js[parser->pos];
+		char c;
+#if TS_JSON_SIMD_SCAN
+		/* skip regular characters of the string */
+		parser->pos = jsmn_scan_string(js, parser->pos, len);
+		if (parser->pos >= len || js[parser->pos] == '\0') {
+			break;
+		}
+#endif
+		c = js[parser->pos];
 
 		/* Quote: end of string */
 		if (c == '\"') {
@@ -151,10 +319,20 @@ static int jsmn_parse_string(jsmn_parser *parser, const char *js,
 int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
 		jsmntok_t *tokens, unsigned int num_tokens) {
 	int r;
+#ifdef JSMN_PARENT_LINKS
 	int i;
+#endif
 	jsmntok_t *token;
 	int count = parser->toknext;
 
+	if (len > JSMN_MAX_LEN) {
+		/* offsets could not be stored in the tokens */
+		return JSMN_ERROR_NOMEM;
+	}
+	if (num_tokens > JSMN_MAX_LEN) {
+		num_tokens = JSMN_MAX_LEN;
+	}
+
 	for (; parser->pos < len && js[parser->pos] != '\0'; parser->pos++) {
 		char c;
 		jsmntype_t type;
@@ -177,6 +355,12 @@ int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
 				}
 				token->type = (c == '{' ? JSMN_OBJECT : JSMN_ARRAY);
 				token->start = parser->pos;
+#ifndef JSMN_PARENT_LINKS
+				/* end is stored as -2 - index of the parent while the token is open,
+				 * so that closing brackets don't have to search for it */
+				token->end = -2 - parser->tokopen;
+				parser->tokopen = parser->toknext - 1;
+#endif
 				parser->toksuper = parser->toknext - 1;
 				break;
 			case '}': case ']':
@@ -206,26 +390,15 @@ int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
 					token = &tokens[token->parent];
 				}
 #else
-				for (i = parser->toknext - 1; i >= 0; i--) {
-					token = &tokens[i];
-					if (token->start != -1 && token->end == -1) {
-						if (token->type != type) {
-							return JSMN_ERROR_INVAL;
-						}
-						parser->toksuper = -1;
-						token->end = parser->pos + 1;
-						break;
-					}
-				}
 				/* Error if unmatched closing bracket */
-				if (i == -1) return JSMN_ERROR_INVAL;
-				for (; i >= 0; i--) {
-					token = &tokens[i];
-					if (token->start != -1 && token->end == -1) {
-						parser->toksuper = i;
-						break;
-					}
+				if (parser->tokopen == -1) return JSMN_ERROR_INVAL;
+				token = &tokens[parser->tokopen];
+				if (token->type != type) {
+					return JSMN_ERROR_INVAL;
 				}
+				parser->tokopen = -2 - token->end;
+				parser->toksuper = parser->tokopen;
+				token->end = parser->pos + 1;
 #endif
 				break;
 			case '\"':
@@ -247,13 +420,8 @@ int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
 #ifdef JSMN_PARENT_LINKS
 					parser->toksuper = tokens[parser->toksuper].parent;
 #else
-					for (i = parser->toknext - 1; i >= 0; i--) {
-						if (tokens[i].type == JSMN_ARRAY || tokens[i].type == JSMN_OBJECT) {
-							if (tokens[i].start != -1 && tokens[i].end == -1) {
-								parser->toksuper = i;
-								break;
-							}
-						}
+					if (parser->tokopen != -1) {
+						parser->toksuper = parser->tokopen;
 					}
 #endif
 				}
@@ -291,12 +459,19 @@ int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
 	}
 
 	if (tokens != NULL) {
+#ifdef JSMN_PARENT_LINKS
 		for (i = parser->toknext - 1; i >= 0; i--) {
 			/* Unmatched opened object or array */
 			if (tokens[i].start != -1 && tokens[i].end == -1) {
 				return JSMN_ERROR_PART;
 			}
 		}
+#else
+		/* Unmatched opened object or array */
+		if (parser->tokopen != -1) {
+			return JSMN_ERROR_PART;
+		}
+#endif
 	}
 
 	return count;
@@ -310,5 +485,8 @@ void jsmn_init(jsmn_parser *parser) {
 	parser->pos = 0;
 	parser->toknext = 0;
 	parser->toksuper = -1;
+#ifndef JSMN_PARENT_LINKS
+	parser->tokopen = -1;
+#endif
 }
 
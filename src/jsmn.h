@@ -4,12 +4,27 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "ts_config.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 #define JSMN_STRICT
 
+/**
+ * Type of offsets in the JSON string and token indices
+ *
+ * 16-bit offsets limit the length of the parsed JSON string to 32767 bytes.
+ */
+#if TS_32BIT_JSON_OFFSETS
+typedef int32_t jsmn_offset_t;
+#define JSMN_MAX_LEN INT32_MAX
+#else
+typedef int16_t jsmn_offset_t;
+#define JSMN_MAX_LEN INT16_MAX
+#endif
+
 /**
  * JSON type identifier. Basic types are:
  * 	o Object
@@ -42,11 +57,11 @@ enum jsmnerr {
  */
 typedef struct {
 	jsmntype_t type;
-	int16_t start;
-	int16_t end;
-	int16_t size;
+	jsmn_offset_t start;
+	jsmn_offset_t end;
+	jsmn_offset_t size;
 #ifdef JSMN_PARENT_LINKS
-	int16_t parent;
+	jsmn_offset_t parent;
 #endif
 } jsmntok_t;
 
@@ -55,9 +70,12 @@ typedef struct {
  * the string being parsed now and current position in that string
  */
 typedef struct {
-	int16_t pos; /**< offset in the JSON string */
-	int16_t toknext; /**< next token to allocate */
-	int16_t toksuper; /**< superior token node, e.g parent object or array */
+	jsmn_offset_t pos; /**< offset in the JSON string */
+	jsmn_offset_t toknext; /**< next token to allocate */
+	jsmn_offset_t toksuper; /**< superior token node, e.g parent object or array */
+#ifndef JSMN_PARENT_LINKS
+	jsmn_offset_t tokopen; /**< innermost object or array that is not closed yet */
+#endif
 } jsmn_parser;
 
 /**
@@ -68,6 +86,8 @@ void jsmn_init(jsmn_parser *parser);
 /**
  * Run JSON parser. It parses a JSON data string into and array of tokens, each describing
  * a single JSON object.
+ *
+ * Strings longer than JSMN_MAX_LEN are rejected with JSMN_ERROR_NOMEM.
  */
 int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
 		jsmntok_t *tokens, unsigned int num_tokens);
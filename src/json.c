@@ -0,0 +1,1357 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#include "json.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+static const char digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/*
+ * Maximum length of a formatted float: sign, 39 digits integer part, point and decimals
+ */
+#define FLOAT_MAX_LEN   (1 + 39 + 1 + JSON_FLOAT_MAX_DIGITS)
+
+static const uint64_t pow5[JSON_FLOAT_MAX_DIGITS + 1] = {
+    1ULL, 5ULL, 25ULL, 125ULL, 625ULL, 3125ULL, 15625ULL, 78125ULL, 390625ULL, 1953125ULL,
+    9765625ULL, 48828125ULL, 244140625ULL, 1220703125ULL, 6103515625ULL, 30517578125ULL,
+    152587890625ULL, 762939453125ULL
+};
+
+/*
+ * Writes the decimal digits of value backwards, two digits at a time, so that the last digit is
+ * stored before end. Returns pointer to the first digit.
+ */
+static char *_format_uint32_rev(char *end, uint32_t value)
+{
+    while (value >= 100) {
+        uint32_t idx = (value % 100) * 2;
+        value /= 100;
+        *--end = digit_pairs[idx + 1];
+        *--end = digit_pairs[idx];
+    }
+    if (value >= 10) {
+        *--end = digit_pairs[value * 2 + 1];
+        *--end = digit_pairs[value * 2];
+    }
+    else {
+        *--end = '0' + value;
+    }
+    return end;
+}
+
+/*
+ * Same as _format_uint32_rev for 64-bit values (64-bit divisions are only needed for the upper
+ * digits of values above UINT32_MAX)
+ */
+static char *_format_uint64_rev(char *end, uint64_t value)
+{
+    while (value > UINT32_MAX) {
+        uint64_t quotient = value / 1000000000U;
+        char *start = _format_uint32_rev(end, (uint32_t)(value - quotient * 1000000000U));
+        end -= 9;
+        while (start > end) {
+            *--start = '0';     // leading zeros of the lower 9 digits
+        }
+        value = quotient;
+    }
+    return _format_uint32_rev(end, (uint32_t)value);
+}
+
+/*
+ * Copies formatted characters to the buffer if they fit (including null termination)
+ *
+ * If buf is NULL, only the length is returned.
+ */
+static int _json_copy(char *buf, const char *str, size_t len, size_t max_len)
+{
+    if (buf == NULL) {
+        return len;
+    }
+    else if (len + 1 > max_len) {
+        return 0;
+    }
+    memcpy(buf, str, len);
+    buf[len] = '\0';
+    return len;
+}
+
+int json_serialize_uint32(char *buf, uint32_t value, size_t max_len)
+{
+    char tmp[10];
+    char *start = _format_uint32_rev(tmp + sizeof(tmp), value);
+    return _json_copy(buf, start, tmp + sizeof(tmp) - start, max_len);
+}
+
+int json_serialize_int32(char *buf, int32_t value, size_t max_len)
+{
+    char tmp[11];
+    char *start = _format_uint32_rev(tmp + sizeof(tmp),
+        (value < 0) ? 0U - (uint32_t)value : (uint32_t)value);
+    if (value < 0) {
+        *--start = '-';
+    }
+    return _json_copy(buf, start, tmp + sizeof(tmp) - start, max_len);
+}
+
+#ifdef TS_64BIT_TYPES_SUPPORT
+
+int json_serialize_uint64(char *buf, uint64_t value, size_t max_len)
+{
+    char tmp[20];
+    char *start = _format_uint64_rev(tmp + sizeof(tmp), value);
+    return _json_copy(buf, start, tmp + sizeof(tmp) - start, max_len);
+}
+
+int json_serialize_int64(char *buf, int64_t value, size_t max_len)
+{
+    char tmp[20];
+    char *start = _format_uint64_rev(tmp + sizeof(tmp),
+        (value < 0) ? 0U - (uint64_t)value : (uint64_t)value);
+    if (value < 0) {
+        *--start = '-';
+    }
+    return _json_copy(buf, start, tmp + sizeof(tmp) - start, max_len);
+}
+
+#endif /* TS_64BIT_TYPES_SUPPORT */
+
+/*
+ * Calculates round(mantissa * 2^exponent * 10^digits) with ties rounded to even
+ *
+ * As mantissa * 5^digits fits into 64 bits, only shifts are needed to get the exact result.
+ * Returns false if the result exceeds 64 bits.
+ */
+static bool _scale_float(uint32_t mantissa, int exponent, int digits, uint64_t *result)
+{
+    uint64_t scaled = (uint64_t)mantissa * pow5[digits];
+    int shift = exponent + digits;
+
+    if (shift == 0) {
+        *result = scaled;
+    }
+    else if (shift > 0) {
+        if (shift >= 64 || (scaled >> (64 - shift)) != 0) {
+            return false;
+        }
+        *result = scaled << shift;
+    }
+    else if (shift > -64) {
+        uint64_t quotient = scaled >> -shift;
+        uint64_t remainder = scaled & ((1ULL << -shift) - 1);
+        uint64_t half = 1ULL << (-shift - 1);
+        if (remainder > half || (remainder == half && (quotient & 1))) {
+            quotient++;
+        }
+        *result = quotient;
+    }
+    else {
+        // value < 1 or exactly 0.5 (rounded to even) if shift is -64, otherwise below 0.5
+        *result = (shift == -64 && scaled > (1ULL << 63)) ? 1 : 0;
+    }
+    return true;
+}
+
+/*
+ * Writes integer mantissa * 2^exponent (exponent >= 0, up to 39 digits) using 9-digit limbs
+ * and returns the number of characters
+ */
+static int _format_large_integer(char *buf, uint32_t mantissa, int exponent)
+{
+    uint32_t limbs[5] = { mantissa };    // least significant limb first
+    int num_limbs = 1;
+
+    while (exponent > 0) {
+        int shift = (exponent > 30) ? 30 : exponent;
+        uint64_t carry = 0;
+        for (int i = 0; i < num_limbs; i++) {
+            uint64_t tmp = ((uint64_t)limbs[i] << shift) + carry;
+            carry = tmp / 1000000000U;
+            limbs[i] = (uint32_t)(tmp - carry * 1000000000U);
+        }
+        if (carry > 0) {
+            limbs[num_limbs++] = (uint32_t)carry;
+        }
+        exponent -= shift;
+    }
+
+    char tmp[9];
+    char *start = _format_uint32_rev(tmp + sizeof(tmp), limbs[num_limbs - 1]);
+    int len = tmp + sizeof(tmp) - start;
+    memcpy(buf, start, len);
+    for (int i = num_limbs - 2; i >= 0; i--) {
+        start = _format_uint32_rev(tmp + sizeof(tmp), limbs[i]);
+        memset(tmp, '0', start - tmp);
+        memcpy(&buf[len], tmp, sizeof(tmp));
+        len += sizeof(tmp);
+    }
+    return len;
+}
+
+/*
+ * Shortest round-trip float formatting based on the Ryu algorithm by Ulf Adams (PLDI 2018)
+ *
+ * The boundaries of the interval of decimal values that round to the same float are computed
+ * with 64-bit fixed-point approximations of powers of 5, so no big integer arithmetic is needed.
+ */
+
+#define POW5_INV_BITCOUNT   59
+#define POW5_BITCOUNT       61
+
+/*
+ * Tables of 2^(pow5bits(i) - 1 + POW5_INV_BITCOUNT) / 5^i + 1 and 5^i / 2^(pow5bits(i) -
+ * POW5_BITCOUNT), where pow5bits(i) is the number of bits of 5^i
+ */
+static const uint64_t pow5_inv_split[55] = {
+    576460752303423489ULL, 461168601842738791ULL, 368934881474191033ULL, 295147905179352826ULL,
+    472236648286964522ULL, 377789318629571618ULL, 302231454903657294ULL, 483570327845851670ULL,
+    386856262276681336ULL, 309485009821345069ULL, 495176015714152110ULL, 396140812571321688ULL,
+    316912650057057351ULL, 507060240091291761ULL, 405648192073033409ULL, 324518553658426727ULL,
+    519229685853482763ULL, 415383748682786211ULL, 332306998946228969ULL, 531691198313966350ULL,
+    425352958651173080ULL, 340282366920938464ULL, 544451787073501542ULL, 435561429658801234ULL,
+    348449143727040987ULL, 557518629963265579ULL, 446014903970612463ULL, 356811923176489971ULL,
+    570899077082383953ULL, 456719261665907162ULL, 365375409332725730ULL, 292300327466180584ULL,
+    467680523945888934ULL, 374144419156711148ULL, 299315535325368918ULL, 478904856520590269ULL,
+    383123885216472215ULL, 306499108173177772ULL, 490398573077084435ULL, 392318858461667548ULL,
+    313855086769334039ULL, 502168138830934462ULL, 401734511064747569ULL, 321387608851798056ULL,
+    514220174162876889ULL, 411376139330301511ULL, 329100911464241209ULL, 526561458342785934ULL,
+    421249166674228747ULL, 336999333339382998ULL, 539198933343012796ULL, 431359146674410237ULL,
+    345087317339528190ULL, 552139707743245103ULL, 441711766194596083ULL
+};
+
+static const uint64_t pow5_split[47] = {
+    1152921504606846976ULL, 1441151880758558720ULL, 1801439850948198400ULL, 2251799813685248000ULL,
+    1407374883553280000ULL, 1759218604441600000ULL, 2199023255552000000ULL, 1374389534720000000ULL,
+    1717986918400000000ULL, 2147483648000000000ULL, 1342177280000000000ULL, 1677721600000000000ULL,
+    2097152000000000000ULL, 1310720000000000000ULL, 1638400000000000000ULL, 2048000000000000000ULL,
+    1280000000000000000ULL, 1600000000000000000ULL, 2000000000000000000ULL, 1250000000000000000ULL,
+    1562500000000000000ULL, 1953125000000000000ULL, 1220703125000000000ULL, 1525878906250000000ULL,
+    1907348632812500000ULL, 1192092895507812500ULL, 1490116119384765625ULL, 1862645149230957031ULL,
+    1164153218269348144ULL, 1455191522836685180ULL, 1818989403545856475ULL, 2273736754432320594ULL,
+    1421085471520200371ULL, 1776356839400250464ULL, 2220446049250313080ULL, 1387778780781445675ULL,
+    1734723475976807094ULL, 2168404344971008868ULL, 1355252715606880542ULL, 1694065894508600678ULL,
+    2117582368135750847ULL, 1323488980084844279ULL, 1654361225106055349ULL, 2067951531382569187ULL,
+    1292469707114105741ULL, 1615587133892632177ULL, 2019483917365790221ULL
+};
+
+/*
+ * Number of bits of 5^e (1 for e = 0), valid for 0 <= e <= 3528
+ */
+static int _pow5_bits(int e)
+{
+    return (int)(((uint32_t)e * 1217359) >> 19) + 1;
+}
+
+/*
+ * floor(log10(2^e)) and floor(log10(5^e)) for small positive e
+ */
+static uint32_t _log10_pow2(int e)
+{
+    return ((uint32_t)e * 78913) >> 18;
+}
+
+static uint32_t _log10_pow5(int e)
+{
+    return ((uint32_t)e * 732923) >> 20;
+}
+
+static bool _multiple_of_pow5(uint32_t value, uint32_t p)
+{
+    uint32_t count = 0;
+    while (value % 5 == 0) {
+        value /= 5;
+        count++;
+    }
+    return count >= p;
+}
+
+static bool _multiple_of_pow2(uint32_t value, uint32_t p)
+{
+    return (value & ((1U << p) - 1)) == 0;
+}
+
+/*
+ * Calculates (m * factor) >> shift for 32 < shift < 96 without 128-bit arithmetic
+ */
+static uint32_t _mul_shift(uint32_t m, uint64_t factor, int shift)
+{
+    uint64_t bits0 = (uint64_t)m * (uint32_t)factor;
+    uint64_t bits1 = (uint64_t)m * (uint32_t)(factor >> 32);
+    uint64_t sum = (bits0 >> 32) + bits1;
+    return (uint32_t)(sum >> (shift - 32));
+}
+
+/*
+ * Determines the shortest decimal representation digits * 10^exp10 of the positive finite float
+ * given by the raw IEEE 754 exponent and mantissa fields
+ */
+static uint32_t _shortest_digits(uint32_t ieee_exponent, uint32_t ieee_mantissa, int *exp10)
+{
+    int e2;
+    uint32_t m2;
+    if (ieee_exponent == 0) {
+        e2 = 1 - 127 - 23 - 2;
+        m2 = ieee_mantissa;
+    }
+    else {
+        e2 = (int)ieee_exponent - 127 - 23 - 2;
+        m2 = (1U << 23) | ieee_mantissa;
+    }
+    bool accept_bounds = (m2 & 1) == 0;     // round to even
+
+    // interval boundaries (multiplied by 4 to have integer values)
+    uint32_t mv = 4 * m2;
+    uint32_t mp = 4 * m2 + 2;
+    uint32_t mm_shift = (ieee_mantissa != 0 || ieee_exponent <= 1) ? 1 : 0;
+    uint32_t mm = 4 * m2 - 1 - mm_shift;
+
+    uint32_t vr, vp, vm;
+    int e10;
+    bool vm_trailing_zeros = false;
+    bool vr_trailing_zeros = false;
+    uint32_t last_removed_digit = 0;
+
+    if (e2 >= 0) {
+        uint32_t q = _log10_pow2(e2);
+        e10 = q;
+        int k = POW5_INV_BITCOUNT + _pow5_bits(q) - 1;
+        int i = -e2 + (int)q + k;
+        vr = _mul_shift(mv, pow5_inv_split[q], i);
+        vp = _mul_shift(mp, pow5_inv_split[q], i);
+        vm = _mul_shift(mm, pow5_inv_split[q], i);
+        if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+            // the last removed digit is needed for correct rounding
+            int l = POW5_INV_BITCOUNT + _pow5_bits(q - 1) - 1;
+            last_removed_digit = _mul_shift(mv, pow5_inv_split[q - 1], -e2 + (int)q - 1 + l) % 10;
+        }
+        if (q <= 9) {
+            // only one of mp, mv and mm can be a multiple of 5
+            if (mv % 5 == 0) {
+                vr_trailing_zeros = _multiple_of_pow5(mv, q);
+            }
+            else if (accept_bounds) {
+                vm_trailing_zeros = _multiple_of_pow5(mm, q);
+            }
+            else {
+                vp -= _multiple_of_pow5(mp, q);
+            }
+        }
+    }
+    else {
+        uint32_t q = _log10_pow5(-e2);
+        e10 = (int)q + e2;
+        int i = -e2 - (int)q;
+        int k = _pow5_bits(i) - POW5_BITCOUNT;
+        int j = (int)q - k;
+        vr = _mul_shift(mv, pow5_split[i], j);
+        vp = _mul_shift(mp, pow5_split[i], j);
+        vm = _mul_shift(mm, pow5_split[i], j);
+        if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+            j = (int)q - 1 - (_pow5_bits(i + 1) - POW5_BITCOUNT);
+            last_removed_digit = _mul_shift(mv, pow5_split[i + 1], j) % 10;
+        }
+        if (q <= 1) {
+            // mv = 4 * m2 has at least 2 trailing zero bits
+            vr_trailing_zeros = true;
+            if (accept_bounds) {
+                vm_trailing_zeros = (mm_shift == 1);
+            }
+            else {
+                vp--;
+            }
+        }
+        else if (q < 31) {
+            vr_trailing_zeros = _multiple_of_pow2(mv, q - 1);
+        }
+    }
+
+    // remove digits as long as the result stays within the interval
+    int removed = 0;
+    uint32_t output;
+    if (vm_trailing_zeros || vr_trailing_zeros) {
+        // rare case with exact decimal boundaries
+        while (vp / 10 > vm / 10) {
+            vm_trailing_zeros &= (vm % 10 == 0);
+            vr_trailing_zeros &= (last_removed_digit == 0);
+            last_removed_digit = vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        if (vm_trailing_zeros) {
+            while (vm % 10 == 0) {
+                vr_trailing_zeros &= (last_removed_digit == 0);
+                last_removed_digit = vr % 10;
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+        if (vr_trailing_zeros && last_removed_digit == 5 && vr % 2 == 0) {
+            last_removed_digit = 4;     // exactly half-way: round to even
+        }
+        output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) ||
+            last_removed_digit >= 5);
+    }
+    else {
+        while (vp / 10 > vm / 10) {
+            last_removed_digit = vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        output = vr + (vr == vm || last_removed_digit >= 5);
+    }
+
+    *exp10 = e10 + removed;
+    return output;
+}
+
+/*
+ * Writes the shortest representation of a positive finite float that is parsed back to the same
+ * value, e.g. 14.4, 1e-7 or 3.4028235e38 (same format as JavaScript, but without + sign in the
+ * exponent) and returns the number of characters
+ */
+static int _format_float_shortest(char *buf, uint32_t ieee_exponent, uint32_t ieee_mantissa)
+{
+    if (ieee_exponent == 0 && ieee_mantissa == 0) {
+        buf[0] = '0';
+        return 1;
+    }
+
+    int exp10;
+    uint32_t output = _shortest_digits(ieee_exponent, ieee_mantissa, &exp10);
+
+    char digits[10];
+    char *start = _format_uint32_rev(digits + sizeof(digits), output);
+    int num_digits = digits + sizeof(digits) - start;
+    int point = num_digits + exp10;     // position of the decimal point relative to start
+    int len = 0;
+
+    if (point >= num_digits && point <= 21) {
+        // integer: 1200
+        memcpy(buf, start, num_digits);
+        memset(&buf[num_digits], '0', point - num_digits);
+        return point;
+    }
+    else if (point > 0 && point <= 21) {
+        // decimal point within the digits: 14.4
+        memcpy(buf, start, point);
+        buf[point] = '.';
+        memcpy(&buf[point + 1], start + point, num_digits - point);
+        return num_digits + 1;
+    }
+    else if (point > -6 && point <= 0) {
+        // leading zeros: 0.0012
+        buf[len++] = '0';
+        buf[len++] = '.';
+        memset(&buf[len], '0', -point);
+        len += -point;
+        memcpy(&buf[len], start, num_digits);
+        return len + num_digits;
+    }
+    else {
+        // exponential notation: 1.5e-7
+        buf[len++] = start[0];
+        if (num_digits > 1) {
+            buf[len++] = '.';
+            memcpy(&buf[len], start + 1, num_digits - 1);
+            len += num_digits - 1;
+        }
+        buf[len++] = 'e';
+        int exponent = point - 1;
+        if (exponent < 0) {
+            buf[len++] = '-';
+            exponent = -exponent;
+        }
+        char exp_digits[3];
+        char *exp_start = _format_uint32_rev(exp_digits + sizeof(exp_digits), exponent);
+        memcpy(&buf[len], exp_start, exp_digits + sizeof(exp_digits) - exp_start);
+        return len + (exp_digits + sizeof(exp_digits) - exp_start);
+    }
+}
+
+/*
+ * Writes the formatted float value without null termination and returns the number of characters
+ *
+ * The buffer must have space for at least FLOAT_MAX_LEN characters.
+ */
+static int _format_float(char *tmp, float value, int digits)
+{
+    int len = 0;
+
+    union {
+        float f;
+        uint32_t u;
+    } bits;
+    bits.f = value;
+
+    uint32_t biased_exponent = (bits.u >> 23) & 0xFF;
+    uint32_t mantissa = bits.u & 0x7FFFFF;
+    int exponent;
+
+    if (biased_exponent == 0xFF) {
+        // NaN and Inf are not supported by JSON
+        memcpy(tmp, "null", 4);
+        return 4;
+    }
+    else if (biased_exponent == 0) {
+        exponent = -149;            // subnormal number
+    }
+    else {
+        mantissa |= 0x800000;       // add implicit leading bit
+        exponent = biased_exponent - 150;
+    }
+
+    if (bits.u >> 31) {
+        tmp[len++] = '-';
+    }
+
+    if (digits < 0) {
+        return len + _format_float_shortest(&tmp[len], biased_exponent, bits.u & 0x7FFFFF);
+    }
+    else if (digits > JSON_FLOAT_MAX_DIGITS) {
+        digits = JSON_FLOAT_MAX_DIGITS;
+    }
+
+    uint64_t scaled;
+    while (!_scale_float(mantissa, exponent, digits, &scaled)) {
+        if (exponent >= 0) {
+            // value is an integer, so all decimal digits are zero
+            len += _format_large_integer(&tmp[len], mantissa, exponent);
+            if (digits > 0) {
+                tmp[len++] = '.';
+                memset(&tmp[len], '0', digits);
+                len += digits;
+            }
+            return len;
+        }
+        digits--;
+    }
+
+    char scaled_digits[20 + JSON_FLOAT_MAX_DIGITS];
+    char *end = scaled_digits + sizeof(scaled_digits);
+    char *start = _format_uint64_rev(end, scaled);
+    while (end - start < digits + 1) {
+        *--start = '0';     // at least one digit in front of the decimal point
+    }
+
+    int int_digits = end - start - digits;
+    memcpy(&tmp[len], start, int_digits);
+    len += int_digits;
+    if (digits > 0) {
+        tmp[len++] = '.';
+        memcpy(&tmp[len], start + int_digits, digits);
+        len += digits;
+    }
+    return len;
+}
+
+int json_serialize_float(char *buf, float value, int digits, size_t max_len)
+{
+    char tmp[FLOAT_MAX_LEN];
+    return _json_copy(buf, tmp, _format_float(tmp, value, digits), max_len);
+}
+
+/*
+ * Returns the number of decimal digits of value
+ */
+static int _count_digits(uint32_t value)
+{
+    if (value < 100000) {
+        return (value < 100) ? 1 + (value >= 10) :
+            (value < 1000) ? 3 : 4 + (value >= 10000);
+    }
+    else {
+        return (value < 10000000) ? 6 + (value >= 1000000) :
+            (value < 100000000) ? 8 : 9 + (value >= 1000000000);
+    }
+}
+
+/*
+ * Writes the value followed by a comma directly to the buffer without bounds check (the buffer
+ * must have space for ARRAY_ELEMENT_MAX_LEN characters) and returns the number of characters
+ */
+static int _write_uint32_elem(char *buf, uint32_t value)
+{
+    int len = _count_digits(value);
+    _format_uint32_rev(buf + len, value);
+    buf[len] = ',';
+    return len + 1;
+}
+
+static int _write_int32_elem(char *buf, int32_t value)
+{
+    if (value < 0) {
+        buf[0] = '-';
+        return 1 + _write_uint32_elem(buf + 1, 0U - (uint32_t)value);
+    }
+    return _write_uint32_elem(buf, value);
+}
+
+static int _write_float_elem(char *buf, float value, int digits)
+{
+    int len = _format_float(buf, value, digits);
+    buf[len] = ',';
+    return len + 1;
+}
+
+/*
+ * Maximum number of characters of an integer array element: sign, 10 digits and comma
+ */
+#define ARRAY_ELEMENT_MAX_LEN   12
+
+/*
+ * Returns the position where the next element can be written directly or tmp if the element
+ * might not fit into the remaining space of the buffer (considering the null termination)
+ */
+static char *_elem_dest(char *buf, size_t pos, size_t max_len, char *tmp, size_t tmp_size)
+{
+    return (max_len - pos > tmp_size) ? &buf[pos] : tmp;
+}
+
+/*
+ * Copies an element formatted in tmp to the buffer if it fits and returns its length, 0 otherwise
+ */
+static int _elem_commit(char *buf, size_t pos, size_t max_len, const char *dest, int len)
+{
+    if (dest != &buf[pos]) {
+        if (pos + len >= max_len) {
+            return 0;
+        }
+        memcpy(&buf[pos], dest, len);
+    }
+    return len;
+}
+
+/*
+ * Opens the array (returns false if the buffer can't even store an empty array)
+ */
+static bool _array_open(char *buf, size_t max_len)
+{
+    if (max_len < 3) {
+        return false;
+    }
+    buf[0] = '[';
+    return true;
+}
+
+/*
+ * Replaces the trailing comma with the closing bracket and returns the total length
+ */
+static int _array_close(char *buf, size_t pos)
+{
+    if (pos == 1) {
+        buf[pos++] = ']';   // empty array
+    }
+    else {
+        buf[pos - 1] = ']';
+    }
+    buf[pos] = '\0';
+    return pos;
+}
+
+/*
+ * Returns the length of an array with the given number of elements, where elem_len is the sum of
+ * the element lengths including the commas
+ */
+static int _array_len(size_t num_elements, size_t elem_len)
+{
+    return (num_elements > 0) ? 1 + elem_len : 2;
+}
+
+int json_serialize_array_uint16(char *buf, const uint16_t *values, size_t num_elements,
+    size_t max_len)
+{
+    size_t pos = 0;
+    if (buf == NULL) {
+        for (size_t i = 0; i < num_elements; i++) {
+            pos += _count_digits(values[i]) + 1;
+        }
+        return _array_len(num_elements, pos);
+    }
+    if (!_array_open(buf, max_len)) {
+        return 0;
+    }
+    pos = 1;
+    for (size_t i = 0; i < num_elements; i++) {
+        char tmp[ARRAY_ELEMENT_MAX_LEN];
+        char *dest = _elem_dest(buf, pos, max_len, tmp, sizeof(tmp));
+        int len = _elem_commit(buf, pos, max_len, dest, _write_uint32_elem(dest, values[i]));
+        if (len == 0) {
+            return 0;
+        }
+        pos += len;
+    }
+    return _array_close(buf, pos);
+}
+
+int json_serialize_array_int16(char *buf, const int16_t *values, size_t num_elements,
+    size_t max_len)
+{
+    size_t pos = 0;
+    if (buf == NULL) {
+        for (size_t i = 0; i < num_elements; i++) {
+            pos += (values[i] < 0) + _count_digits(values[i] < 0 ? -values[i] : values[i]) + 1;
+        }
+        return _array_len(num_elements, pos);
+    }
+    if (!_array_open(buf, max_len)) {
+        return 0;
+    }
+    pos = 1;
+    for (size_t i = 0; i < num_elements; i++) {
+        char tmp[ARRAY_ELEMENT_MAX_LEN];
+        char *dest = _elem_dest(buf, pos, max_len, tmp, sizeof(tmp));
+        int len = _elem_commit(buf, pos, max_len, dest, _write_int32_elem(dest, values[i]));
+        if (len == 0) {
+            return 0;
+        }
+        pos += len;
+    }
+    return _array_close(buf, pos);
+}
+
+int json_serialize_array_uint32(char *buf, const uint32_t *values, size_t num_elements,
+    size_t max_len)
+{
+    size_t pos = 0;
+    if (buf == NULL) {
+        for (size_t i = 0; i < num_elements; i++) {
+            pos += _count_digits(values[i]) + 1;
+        }
+        return _array_len(num_elements, pos);
+    }
+    if (!_array_open(buf, max_len)) {
+        return 0;
+    }
+    pos = 1;
+    for (size_t i = 0; i < num_elements; i++) {
+        char tmp[ARRAY_ELEMENT_MAX_LEN];
+        char *dest = _elem_dest(buf, pos, max_len, tmp, sizeof(tmp));
+        int len = _elem_commit(buf, pos, max_len, dest, _write_uint32_elem(dest, values[i]));
+        if (len == 0) {
+            return 0;
+        }
+        pos += len;
+    }
+    return _array_close(buf, pos);
+}
+
+int json_serialize_array_int32(char *buf, const int32_t *values, size_t num_elements,
+    size_t max_len)
+{
+    size_t pos = 0;
+    if (buf == NULL) {
+        for (size_t i = 0; i < num_elements; i++) {
+            uint32_t abs = (values[i] < 0) ? 0U - (uint32_t)values[i] : (uint32_t)values[i];
+            pos += (values[i] < 0) + _count_digits(abs) + 1;
+        }
+        return _array_len(num_elements, pos);
+    }
+    if (!_array_open(buf, max_len)) {
+        return 0;
+    }
+    pos = 1;
+    for (size_t i = 0; i < num_elements; i++) {
+        char tmp[ARRAY_ELEMENT_MAX_LEN];
+        char *dest = _elem_dest(buf, pos, max_len, tmp, sizeof(tmp));
+        int len = _elem_commit(buf, pos, max_len, dest, _write_int32_elem(dest, values[i]));
+        if (len == 0) {
+            return 0;
+        }
+        pos += len;
+    }
+    return _array_close(buf, pos);
+}
+
+int json_serialize_array_float(char *buf, const float *values, size_t num_elements, int digits,
+    size_t max_len)
+{
+    size_t pos = 0;
+    if (buf == NULL) {
+        char tmp[FLOAT_MAX_LEN + 1];
+        for (size_t i = 0; i < num_elements; i++) {
+            pos += _write_float_elem(tmp, values[i], digits);
+        }
+        return _array_len(num_elements, pos);
+    }
+    if (!_array_open(buf, max_len)) {
+        return 0;
+    }
+    pos = 1;
+    for (size_t i = 0; i < num_elements; i++) {
+        char tmp[FLOAT_MAX_LEN + 1];
+        char *dest = _elem_dest(buf, pos, max_len, tmp, sizeof(tmp));
+        int len = _elem_commit(buf, pos, max_len, dest, _write_float_elem(dest, values[i], digits));
+        if (len == 0) {
+            return 0;
+        }
+        pos += len;
+    }
+    return _array_close(buf, pos);
+}
+
+/*
+ * Byte patterns for the word-at-a-time scan of strings
+ */
+#define BYTES_ONES      0x0101010101010101ULL
+#define BYTES_HIGH_BITS 0x8080808080808080ULL
+
+/*
+ * Returns true if any of the 8 bytes is a control character, a quote or a backslash
+ *
+ * A byte b is below n if b - n borrows (high bit set) while the high bit of b itself was not set.
+ * Bytes equal to a character are found the same way after XOR with the character (zero bytes).
+ */
+static bool _word_needs_escape(uint64_t word)
+{
+    uint64_t quote = word ^ (BYTES_ONES * '"');
+    uint64_t backslash = word ^ (BYTES_ONES * '\\');
+    uint64_t special = ((word - BYTES_ONES * 0x20) & ~word) |
+        ((quote - BYTES_ONES) & ~quote) |
+        ((backslash - BYTES_ONES) & ~backslash);
+    return (special & BYTES_HIGH_BITS) != 0;
+}
+
+static bool _char_needs_escape(char c)
+{
+    return (uint8_t)c < 0x20 || c == '"' || c == '\\';
+}
+
+size_t json_find_escape(const char *str, size_t len)
+{
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control_max = _mm_set1_epi8(0x1F);
+    for (; i + 16 <= len; i += 16) {
+        __m128i chars = _mm_loadu_si128((const __m128i *)&str[i]);
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chars, quote), _mm_cmpeq_epi8(chars, backslash)),
+            _mm_cmpeq_epi8(_mm_min_epu8(chars, control_max), chars));
+        int mask = _mm_movemask_epi8(special);
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+    for (; i + 8 <= len; i += 8) {
+        uint64_t word;
+        memcpy(&word, &str[i], sizeof(word));
+        if (_word_needs_escape(word)) {
+            break;
+        }
+    }
+    while (i < len && !_char_needs_escape(str[i])) {
+        i++;
+    }
+    return i;
+}
+
+/*
+ * Writes the escape sequence for a special character and returns its length
+ */
+static int _escape_char(char *buf, char c)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    buf[0] = '\\';
+    switch (c) {
+    case '"':
+    case '\\':
+        buf[1] = c;
+        return 2;
+    case '\b':
+        buf[1] = 'b';
+        return 2;
+    case '\f':
+        buf[1] = 'f';
+        return 2;
+    case '\n':
+        buf[1] = 'n';
+        return 2;
+    case '\r':
+        buf[1] = 'r';
+        return 2;
+    case '\t':
+        buf[1] = 't';
+        return 2;
+    default:
+        memcpy(&buf[1], "u00", 3);
+        buf[4] = hex[(uint8_t)c >> 4];
+        buf[5] = hex[c & 0x0F];
+        return 6;
+    }
+}
+
+int json_serialize_string(char *buf, const char *str, size_t len, size_t max_len)
+{
+    size_t pos = 0;
+    size_t start = 0;
+
+    if (buf == NULL) {
+        size_t total = len + 2;
+        char esc[6];
+        for (size_t i = json_find_escape(str, len); i < len;
+                i += 1 + json_find_escape(&str[i + 1], len - i - 1)) {
+            total += _escape_char(esc, str[i]) - 1;
+        }
+        return total;
+    }
+
+    if (len + 3 > max_len) {
+        return 0;
+    }
+    buf[pos++] = '"';
+
+    while (start < len) {
+        // copy characters up to the next one which has to be escaped
+        size_t run = json_find_escape(&str[start], len - start);
+        if (pos + run + 2 > max_len) {
+            return 0;
+        }
+        memcpy(&buf[pos], &str[start], run);
+        pos += run;
+        start += run;
+        if (start < len) {
+            char esc[6];
+            int esc_len = _escape_char(esc, str[start]);
+            if (pos + esc_len + 2 > max_len) {
+                return 0;
+            }
+            memcpy(&buf[pos], esc, esc_len);
+            pos += esc_len;
+            start++;
+        }
+    }
+
+    buf[pos++] = '"';
+    buf[pos] = '\0';
+    return pos;
+}
+
+/*
+ * Number parsing without strtod/strtol (no null termination, locale or errno needed)
+ */
+
+/*
+ * Parses decimal or hexadecimal (0x prefix) digits of an unsigned integer
+ *
+ * A fractional part is accepted and truncated, as done by strtoul before. Returns the number of
+ * characters parsed or 0 if the value is not a valid number or larger than max.
+ */
+static size_t _parse_uint(const char *str, size_t len, uint64_t max, uint64_t *value)
+{
+    size_t pos = 0;
+    uint64_t result = 0;
+
+    if (len > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+        for (pos = 2; pos < len; pos++) {
+            char c = str[pos];
+            uint32_t digit;
+            if (c >= '0' && c <= '9') {
+                digit = c - '0';
+            }
+            else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+                digit = (c | 0x20) - 'a' + 10;
+            }
+            else {
+                return 0;
+            }
+            if (digit > max || result > (max - digit) / 16) {
+                return 0;
+            }
+            result = result * 16 + digit;
+        }
+        *value = result;
+        return pos;
+    }
+
+    for (; pos < len && str[pos] >= '0' && str[pos] <= '9'; pos++) {
+        uint32_t digit = str[pos] - '0';
+        if (digit > max || result > (max - digit) / 10) {
+            return 0;
+        }
+        result = result * 10 + digit;
+    }
+    if (pos == 0) {
+        return 0;
+    }
+    if (pos < len && str[pos] == '.') {
+        for (pos++; pos < len && str[pos] >= '0' && str[pos] <= '9'; pos++) {
+        }
+    }
+    if (pos != len) {
+        return 0;
+    }
+
+    *value = result;
+    return pos;
+}
+
+int json_deserialize_uint64(const char *str, size_t len, uint64_t max, uint64_t *value)
+{
+    if (len > 1 && str[0] == '-') {
+        // only -0 is allowed
+        uint64_t zero;
+        if (_parse_uint(str + 1, len - 1, 0, &zero) == 0) {
+            return 0;
+        }
+        *value = 0;
+        return len;
+    }
+    return _parse_uint(str, len, max, value);
+}
+
+int json_deserialize_int64(const char *str, size_t len, int64_t min, int64_t max, int64_t *value)
+{
+    uint64_t abs_value;
+    if (len > 1 && str[0] == '-') {
+        if (min > 0 || _parse_uint(str + 1, len - 1, 0 - (uint64_t)min, &abs_value) == 0) {
+            return 0;
+        }
+        *value = (int64_t)(0 - abs_value);
+        return len;
+    }
+    if (max < 0 || _parse_uint(str, len, (uint64_t)max, &abs_value) == 0) {
+        return 0;
+    }
+    *value = (int64_t)abs_value;
+    return len;
+}
+
+#define FLOAT_MANTISSA_BITS     23
+#define FLOAT_EXPONENT_BIAS     127
+#define FLOAT_INFINITY_BITS     0x7F800000U
+
+/*
+ * Maximum number of significant decimal digits converted exactly by _float_bits
+ */
+#define FLOAT_PARSE_DIGITS      9
+
+static int _floor_log2(uint32_t value)
+{
+#ifdef __GNUC__
+    return 31 - __builtin_clz(value);
+#else
+    int bits = -1;
+    while (value != 0) {
+        value >>= 1;
+        bits++;
+    }
+    return bits;
+#endif
+}
+
+/*
+ * Converts m10 * 10^e10 with m10 < 10^9 to the closest float (ties to even) and returns its raw
+ * IEEE 754 bits without sign
+ *
+ * Based on the string to float conversion of the Ryu algorithm, using the same tables as the
+ * shortest float formatting above.
+ */
+static uint32_t _float_bits(uint32_t m10, int e10)
+{
+    int m10_digits = _count_digits(m10);
+    if (m10 == 0 || m10_digits + e10 <= -46) {
+        return 0;
+    }
+    if (m10_digits + e10 >= 40) {
+        return FLOAT_INFINITY_BITS;
+    }
+
+    // binary representation m2 * 2^e2 with 25 or 26 significant bits
+    int e2;
+    uint32_t m2;
+    bool trailing_zeros;
+    if (e10 >= 0) {
+        e2 = _floor_log2(m10) + e10 + _pow5_bits(e10) - 1 - (FLOAT_MANTISSA_BITS + 1);
+        int j = e2 - e10 - _pow5_bits(e10) + POW5_BITCOUNT;
+        m2 = _mul_shift(m10, pow5_split[e10], j);
+        trailing_zeros = e2 < e10 || (e2 - e10 < 32 && _multiple_of_pow2(m10, e2 - e10));
+    }
+    else {
+        e2 = _floor_log2(m10) + e10 - _pow5_bits(-e10) - (FLOAT_MANTISSA_BITS + 1);
+        int j = e2 - e10 + _pow5_bits(-e10) - 1 + POW5_INV_BITCOUNT;
+        m2 = _mul_shift(m10, pow5_inv_split[-e10], j);
+        trailing_zeros = (e2 < e10 || (e2 - e10 < 32 && _multiple_of_pow2(m10, e2 - e10))) &&
+            _multiple_of_pow5(m10, -e10);
+    }
+
+    int ieee_e2 = e2 + FLOAT_EXPONENT_BIAS + _floor_log2(m2);
+    if (ieee_e2 < 0) {
+        ieee_e2 = 0;
+    }
+    if (ieee_e2 > 0xFE) {
+        return FLOAT_INFINITY_BITS;
+    }
+
+    // remove the additional bits with correct rounding (ties to even)
+    int shift = (ieee_e2 == 0 ? 1 : ieee_e2) - e2 - FLOAT_EXPONENT_BIAS - FLOAT_MANTISSA_BITS;
+    trailing_zeros &= (m2 & ((1U << (shift - 1)) - 1)) == 0;
+    uint32_t last_removed_bit = (m2 >> (shift - 1)) & 1;
+    bool round_up = last_removed_bit != 0 && (!trailing_zeros || ((m2 >> shift) & 1) != 0);
+
+    uint32_t ieee_m2 = (m2 >> shift) + round_up;
+    ieee_m2 &= (1U << FLOAT_MANTISSA_BITS) - 1;
+    if (ieee_m2 == 0 && round_up) {
+        // mantissa overflow moves into the exponent
+        ieee_e2++;
+    }
+    return ((uint32_t)ieee_e2 << FLOAT_MANTISSA_BITS) | ieee_m2;
+}
+
+/*
+ * Minimal fixed-size big integers (little endian 32-bit words), only used to decide the rounding
+ * direction of decimal numbers with more than FLOAT_PARSE_DIGITS significant digits
+ */
+#define BIG_WORDS   16
+
+/*
+ * Maximum number of significant decimal digits considered for rounding decisions. The value
+ * halfway between two floats has max. 112 significant digits, so further digits are only
+ * relevant if they are non-zero.
+ */
+#define BIG_DIGITS  120
+
+static void _big_mul_add(uint32_t *big, uint32_t factor, uint32_t add)
+{
+    uint64_t carry = add;
+    for (int i = 0; i < BIG_WORDS; i++) {
+        carry += (uint64_t)big[i] * factor;
+        big[i] = (uint32_t)carry;
+        carry >>= 32;
+    }
+}
+
+static void _big_mul_pow5(uint32_t *big, int exp)
+{
+    for (; exp >= 13; exp -= 13) {
+        _big_mul_add(big, 1220703125U, 0);      // 5^13
+    }
+    _big_mul_add(big, (uint32_t)pow5[exp], 0);
+}
+
+static void _big_shift_left(uint32_t *big, int bits)
+{
+    int words = bits / 32;
+    bits %= 32;
+    for (int i = BIG_WORDS - 1; i >= 0; i--) {
+        uint32_t value = (i >= words) ? big[i - words] << bits : 0;
+        if (bits > 0 && i > words) {
+            value |= big[i - words - 1] >> (32 - bits);
+        }
+        big[i] = value;
+    }
+}
+
+static int _big_compare(const uint32_t *a, const uint32_t *b)
+{
+    for (int i = BIG_WORDS - 1; i >= 0; i--) {
+        if (a[i] != b[i]) {
+            return a[i] > b[i] ? 1 : -1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Compares the decimal number given by its digits (decimal point is skipped) multiplied with
+ * 10^e10 with the value halfway between the float given by its raw bits and the next larger float
+ */
+static int _compare_halfway(const char *digits, size_t len, int e10, uint32_t bits)
+{
+    uint32_t decimal[BIG_WORDS] = { 0 };
+    uint32_t halfway[BIG_WORDS] = { 0 };
+    bool sticky = false;        // non-zero digits beyond BIG_DIGITS
+    int num_digits = 0;
+    uint32_t chunk = 0;
+    uint32_t chunk_factor = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (digits[i] == '.' || (num_digits == 0 && digits[i] == '0')) {
+            continue;
+        }
+        if (num_digits >= BIG_DIGITS) {
+            sticky |= digits[i] != '0';
+            e10++;
+            continue;
+        }
+        num_digits++;
+        chunk = chunk * 10 + (digits[i] - '0');
+        chunk_factor *= 10;
+        if (chunk_factor == 1000000000U) {
+            _big_mul_add(decimal, chunk_factor, chunk);
+            chunk = 0;
+            chunk_factor = 1;
+        }
+    }
+    _big_mul_add(decimal, chunk_factor, chunk);
+
+    uint32_t ieee_e2 = bits >> FLOAT_MANTISSA_BITS;
+    uint32_t m2 = bits & ((1U << FLOAT_MANTISSA_BITS) - 1);
+    int e2 = -FLOAT_EXPONENT_BIAS - FLOAT_MANTISSA_BITS + 1;
+    if (ieee_e2 > 0) {
+        m2 |= 1U << FLOAT_MANTISSA_BITS;
+        e2 += ieee_e2 - 1;
+    }
+
+    // decimal * 5^e10 * 2^e10 compared to (2 * m2 + 1) * 2^(e2 - 1)
+    halfway[0] = 2 * m2 + 1;
+    if (e10 >= 0) {
+        _big_mul_pow5(decimal, e10);
+    }
+    else {
+        _big_mul_pow5(halfway, -e10);
+    }
+    int shift = e10 - (e2 - 1);
+    if (shift >= 0) {
+        _big_shift_left(decimal, shift);
+    }
+    else {
+        _big_shift_left(halfway, -shift);
+    }
+
+    int cmp = _big_compare(decimal, halfway);
+    return (cmp == 0 && sticky) ? 1 : cmp;
+}
+
+int json_deserialize_float(const char *str, size_t len, float *value)
+{
+    size_t pos = 0;
+    bool negative = false;
+    uint64_t m10 = 0;           // first 19 significant digits
+    int m10_digits = 0;
+    int e10 = 0;
+    bool truncated = false;     // non-zero digits beyond the digits stored in m10
+    int frac_digits = 0;
+
+    if (pos < len && str[pos] == '-') {
+        negative = true;
+        pos++;
+    }
+    size_t digits_start = pos;
+
+    for (; pos < len && str[pos] >= '0' && str[pos] <= '9'; pos++) {
+        if (m10_digits < 19) {
+            m10 = m10 * 10 + (str[pos] - '0');
+            m10_digits += (m10 != 0);
+        }
+        else {
+            truncated |= str[pos] != '0';
+            e10++;
+        }
+    }
+    int int_digits = pos - digits_start;
+    if (pos < len && str[pos] == '.') {
+        for (pos++; pos < len && str[pos] >= '0' && str[pos] <= '9'; pos++) {
+            frac_digits++;
+            if (m10_digits < 19) {
+                m10 = m10 * 10 + (str[pos] - '0');
+                m10_digits += (m10 != 0);
+                e10--;
+            }
+            else {
+                truncated |= str[pos] != '0';
+            }
+        }
+    }
+    size_t digits_len = pos - digits_start;
+    if (int_digits + frac_digits == 0) {
+        return 0;
+    }
+
+    int exp = 0;
+    if (pos < len && (str[pos] == 'e' || str[pos] == 'E')) {
+        bool exp_negative = false;
+        pos++;
+        if (pos < len && (str[pos] == '-' || str[pos] == '+')) {
+            exp_negative = str[pos] == '-';
+            pos++;
+        }
+        if (pos == len) {
+            return 0;
+        }
+        for (; pos < len && str[pos] >= '0' && str[pos] <= '9'; pos++) {
+            if (exp < 10000) {
+                exp = exp * 10 + (str[pos] - '0');
+            }
+        }
+        if (exp_negative) {
+            exp = -exp;
+        }
+    }
+    if (pos != len) {
+        return 0;
+    }
+    e10 += exp;
+
+    uint32_t bits;
+    if (m10 == 0) {
+        bits = 0;
+    }
+    else if (m10_digits + e10 <= -46) {
+        bits = 0;
+    }
+    else if (m10_digits + e10 >= 40) {
+        bits = FLOAT_INFINITY_BITS;
+    }
+    else {
+        // reduce to the number of digits supported by the exact conversion
+        uint32_t m10_short;
+        int e10_short = e10;
+        bool inexact = truncated;
+        while (m10 >= 1000000000U) {
+            inexact |= (m10 % 10) != 0;
+            m10 /= 10;
+            e10_short++;
+        }
+        m10_short = (uint32_t)m10;
+        bits = _float_bits(m10_short, e10_short);
+        if (inexact) {
+            // the exact value is between m10_short and m10_short + 1, which round to the same
+            // float or to two adjacent floats
+            uint32_t upper = (m10_short + 1 == 1000000000U) ?
+                _float_bits(100000000U, e10_short + 1) :
+                _float_bits(m10_short + 1, e10_short);
+            if (upper != bits) {
+                int cmp = _compare_halfway(&str[digits_start], digits_len, exp - frac_digits,
+                    bits);
+                if (cmp > 0 || (cmp == 0 && (bits & 1))) {
+                    bits = upper;
+                }
+            }
+        }
+    }
+
+    if (bits >= FLOAT_INFINITY_BITS) {
+        return 0;   // out of range
+    }
+    bits |= (uint32_t)negative << 31;
+    memcpy(value, &bits, sizeof(float));
+    return len;
+}
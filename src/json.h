@@ -0,0 +1,275 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#ifndef JSON_H_
+#define JSON_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "ts_config.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/*
+ * Fast formatting of JSON values without printf
+ *
+ * All functions write the value followed by a null termination (same as snprintf). They don't
+ * allocate memory and don't depend on the locale.
+ *
+ * If buf is NULL, nothing is written and the length of the formatted value is returned (max_len
+ * is ignored in this case).
+ */
+
+/**
+ * Maximum number of decimal digits supported by json_serialize_float
+ */
+#define JSON_FLOAT_MAX_DIGITS   17
+
+/**
+ * Number of digits for json_serialize_float to get the shortest representation that is parsed
+ * back to the same float value
+ */
+#define JSON_FLOAT_SHORTEST     (-1)
+
+/**
+ * Serialize 32-bit unsigned integer
+ *
+ * @param buf Buffer where the JSON data shall be stored
+ * @param value Variable containing value to be serialized
+ * @param max_len Maximum remaining space in buffer (including null termination)
+ *
+ * @returns Number of characters added to buffer (without null termination) or 0 in case of error
+ */
+int json_serialize_uint32(char *buf, uint32_t value, size_t max_len);
+
+/**
+ * Serialize 32-bit signed integer
+ *
+ * @param buf Buffer where the JSON data shall be stored
+ * @param value Variable containing value to be serialized
+ * @param max_len Maximum remaining space in buffer (including null termination)
+ *
+ * @returns Number of characters added to buffer (without null termination) or 0 in case of error
+ */
+int json_serialize_int32(char *buf, int32_t value, size_t max_len);
+
+#ifdef TS_64BIT_TYPES_SUPPORT
+/**
+ * Serialize 64-bit unsigned integer
+ *
+ * @param buf Buffer where the JSON data shall be stored
+ * @param value Variable containing value to be serialized
+ * @param max_len Maximum remaining space in buffer (including null termination)
+ *
+ * @returns Number of characters added to buffer (without null termination) or 0 in case of error
+ */
+int json_serialize_uint64(char *buf, uint64_t value, size_t max_len);
+
+/**
+ * Serialize 64-bit signed integer
+ *
+ * @param buf Buffer where the JSON data shall be stored
+ * @param value Variable containing value to be serialized
+ * @param max_len Maximum remaining space in buffer (including null termination)
+ *
+ * @returns Number of characters added to buffer (without null termination) or 0 in case of error
+ */
+int json_serialize_int64(char *buf, int64_t value, size_t max_len);
+#endif
+
+/**
+ * Serialize 32-bit float with fixed number of decimal digits
+ *
+ * The result is identical to printf with "%.*f" format (exact rounding, ties to even). NaN and
+ * infinity are not supported by JSON, so null is used instead.
+ *
+ * In the very unlikely case that more than 12 digits are requested for a value above 2^64 /
+ * 10^digits, which is not an integer, the number of digits is reduced.
+ *
+ * If digits is negative (JSON_FLOAT_SHORTEST), the shortest representation that is parsed back
+ * to the same float value is used instead, e.g. 14.4, 1e-7 or 3.4028235e38 (same as JavaScript,
+ * but without + sign in the exponent).
+ *
+ * @param buf Buffer where the JSON data shall be stored
+ * @param value Variable containing value to be serialized
+ * @param digits Number of decimal digits (max. JSON_FLOAT_MAX_DIGITS) or JSON_FLOAT_SHORTEST
+ * @param max_len Maximum remaining space in buffer (including null termination)
+ *
+ * @returns Number of characters added to buffer (without null termination) or 0 in case of error
+ */
+int json_serialize_float(char *buf, float value, int digits, size_t max_len);
+
+/*
+ * Bulk serialization of numeric arrays
+ *
+ * The complete array including the brackets is written in one call (e.g. "[1,2,3]"). Elements are
+ * formatted directly into the buffer as long as enough space is left, so that the bounds only have
+ * to be checked exactly close to the end of the buffer. The result is identical to serializing
+ * each element with the functions above.
+ */
+
+/**
+ * Serialize array of 16-bit unsigned integers
+ *
+ * @param buf Buffer where the JSON data shall be stored
+ * @param values Pointer to the first element of the array
+ * @param num_elements Number of elements to be serialized
+ * @param max_len Maximum remaining space in buffer (including null termination)
+ *
+ * @returns Number of characters added to buffer (without null termination) or 0 in case of error
+ */
+int json_serialize_array_uint16(char *buf, const uint16_t *values, size_t num_elements,
+    size_t max_len);
+
+/**
+ * Serialize array of 16-bit signed integers
+ *
+ * @param buf Buffer where the JSON data shall be stored
+ * @param values Pointer to the first element of the array
+ * @param num_elements Number of elements to be serialized
+ * @param max_len Maximum remaining space in buffer (including null termination)
+ *
+ * @returns Number of characters added to buffer (without null termination) or 0 in case of error
+ */
+int json_serialize_array_int16(char *buf, const int16_t *values, size_t num_elements,
+    size_t max_len);
+
+/**
+ * Serialize array of 32-bit unsigned integers
+ *
+ * @param buf Buffer where the JSON data shall be stored
+ * @param values Pointer to the first element of the array
+ * @param num_elements Number of elements to be serialized
+ * @param max_len Maximum remaining space in buffer (including null termination)
+ *
+ * @returns Number of characters added to buffer (without null termination) or 0 in case of error
+ */
+int json_serialize_array_uint32(char *buf, const uint32_t *values, size_t num_elements,
+    size_t max_len);
+
+/**
+ * Serialize array of 32-bit signed integers
+ *
+ * @param buf Buffer where the JSON data shall be stored
+ * @param values Pointer to the first element of the array
+ * @param num_elements Number of elements to be serialized
+ * @param max_len Maximum remaining space in buffer (including null termination)
+ *
+ * @returns Number of characters added to buffer (without null termination) or 0 in case of error
+ */
+int json_serialize_array_int32(char *buf, const int32_t *values, size_t num_elements,
+    size_t max_len);
+
+/**
+ * Serialize array of 32-bit floats with fixed number of decimal digits
+ *
+ * @param buf Buffer where the JSON data shall be stored
+ * @param values Pointer to the first element of the array
+ * @param num_elements Number of elements to be serialized
+ * @param digits Number of decimal digits (max. JSON_FLOAT_MAX_DIGITS) or JSON_FLOAT_SHORTEST
+ * @param max_len Maximum remaining space in buffer (including null termination)
+ *
+ * @returns Number of characters added to buffer (without null termination) or 0 in case of error
+ */
+int json_serialize_array_float(char *buf, const float *values, size_t num_elements, int digits,
+    size_t max_len);
+
+/**
+ * Find the first character of a string which has to be escaped in JSON
+ *
+ * Control characters, quotes and backslashes have to be escaped. The string is scanned 8 bytes
+ * at a time (16 bytes with SSE2), as such characters are rare.
+ *
+ * @param str Pointer to the string (no null termination required)
+ * @param len Length of the string
+ *
+ * @returns Position of the first character to be escaped or len if there is none
+ */
+size_t json_find_escape(const char *str, size_t len);
+
+/**
+ * Serialize string in quotes with escape sequences for special characters
+ *
+ * @param buf Buffer where the JSON data shall be stored
+ * @param str Pointer to the string (no null termination required)
+ * @param len Length of the string
+ * @param max_len Maximum remaining space in buffer (including null termination)
+ *
+ * @returns Number of characters added to buffer (without null termination) or 0 in case of error
+ */
+int json_serialize_string(char *buf, const char *str, size_t len, size_t max_len);
+
+/*
+ * Fast parsing of JSON numbers without strtod/strtol
+ *
+ * The numbers are parsed directly from the JSON string (no null termination required) and
+ * don't depend on the locale. The entire string has to be a valid number.
+ *
+ * Differences to the previously used strtol(str, NULL, 0) and strtod:
+ * - Leading whitespace and a leading + sign are rejected.
+ * - Numbers with leading zeros are decimal, not octal ("027" is 27).
+ * - Hexadecimal numbers (0x prefix) are only accepted for integers, not for floats.
+ * - Exponents are only accepted for floats ("1e3" is rejected for integers instead of
+ *   returning 1).
+ * - Trailing characters are rejected instead of being ignored ("12a" is not 12).
+ * - inf and nan are rejected for floats.
+ */
+
+/**
+ * Parse unsigned integer with range check
+ *
+ * Decimal and hexadecimal (0x prefix) numbers are supported. A fractional part is truncated,
+ * exponents are not supported. Negative values are rejected, except for -0.
+ *
+ * @param str Pointer to the number
+ * @param len Length of the number
+ * @param max Maximum allowed value (e.g. UINT16_MAX for uint16_t)
+ * @param value Pointer to store the result
+ *
+ * @returns Number of characters parsed (len) or 0 in case of error or value out of range
+ */
+int json_deserialize_uint64(const char *str, size_t len, uint64_t max, uint64_t *value);
+
+/**
+ * Parse signed integer with range check
+ *
+ * Decimal and hexadecimal (0x prefix) numbers are supported. A fractional part is truncated,
+ * exponents are not supported.
+ *
+ * @param str Pointer to the number
+ * @param len Length of the number
+ * @param min Minimum allowed value (e.g. INT16_MIN for int16_t)
+ * @param max Maximum allowed value (e.g. INT16_MAX for int16_t)
+ * @param value Pointer to store the result
+ *
+ * @returns Number of characters parsed (len) or 0 in case of error or value out of range
+ */
+int json_deserialize_int64(const char *str, size_t len, int64_t min, int64_t max, int64_t *value);
+
+/**
+ * Parse 32-bit float
+ *
+ * The result is correctly rounded (ties to even) for any number of digits, using only integer
+ * arithmetic. Values too large for a float are treated as error, very small values become 0.
+ * Only decimal numbers (with optional exponent) are supported.
+ *
+ * @param str Pointer to the number
+ * @param len Length of the number
+ * @param value Pointer to store the result
+ *
+ * @returns Number of characters parsed (len) or 0 in case of error or value out of range
+ */
+int json_deserialize_float(const char *str, size_t len, float *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JSON_H_ */
@@ -33,10 +33,21 @@ void pub_thread()
     }
 }
 
-int main()
+int main(int argc, char *argv[])
 {
     uint8_t resp_buf[1000];
 
+    if (ts.get_status() == TS_STATUS_CONFLICT) {
+        fprintf(stderr, "ThingSet error: Duplicate data node ID 0x%X.\n",
+            (unsigned int)ts.get_conflicting_id());
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--dump-index") == 0) {
+        // generate node lookup tables to be stored in flash
+        ts.dump_index("data_nodes");
+        return 0;
+    }
+
     printf("\n----------------- Data node tree ---------------------\n");
 
     ts.dump_json();
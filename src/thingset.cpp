@@ -8,23 +8,14 @@
 #include "thingset.h"
 #include "jsmn.h"
 #include "cbor.h"
+#include "json.h"
 
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #define DEBUG 0
 
-static void _check_id_duplicates(const DataNode *data, size_t num)
-{
-    for (unsigned int i = 0; i < num; i++) {
-        for (unsigned int j = i + 1; j < num; j++) {
-            if (data[i].id == data[j].id) {
-                printf("ThingSet error: Duplicate data node ID 0x%X.\n", data[i].id);
-            }
-        }
-    }
-}
-
 /*
  * Counts the number of elements in an an array of node IDs by looking for the first non-zero
  * elements starting from the back.
@@ -32,12 +23,14 @@ static void _check_id_duplicates(const DataNode *data, size_t num)
  * Currently only supporting uint16_t (node_id_t) arrays as we need the size of each element
  * to iterate through the array.
  */
-static void _count_array_elements(const DataNode *data, size_t num)
+static bool _count_array_elements(const DataNode *data, size_t num)
 {
+    bool autodetected = false;
     for (unsigned int i = 0; i < num; i++) {
         if (data[i].type == TS_T_ARRAY) {
             ArrayInfo *arr = (ArrayInfo *)data[i].data;
             if (arr->num_elements == TS_AUTODETECT_ARRLEN) {
+                autodetected = true;
                 arr->num_elements = 0;  // set to safe default
                 if (arr->type == TS_T_NODE_ID) {
                     for (int elem = arr->max_elements - 1; elem >= 0; elem--) {
@@ -49,24 +42,840 @@ static void _count_array_elements(const DataNode *data, size_t num)
                     }
                 }
                 else {
-                    printf("Autodetecting array length of node 0x%X not possible.\n", data[i].id);
+                    printf("Autodetecting array length of node 0x%X not possible.\n",
+                        (unsigned int)data[i].id);
                 }
             }
         }
     }
+    return autodetected;
+}
+
+/*
+ * Sorts the ID index by ascending node ID (heapsort, as it works in place and does not need any
+ * recursion or additional memory).
+ */
+static void _sort_id_index(TsIdIndexEntry *index, size_t num)
+{
+    if (num < 2) {
+        return;
+    }
+
+    // build max heap
+    for (size_t start = num / 2; start-- > 0; ) {
+        size_t root = start;
+        while (2 * root + 1 < num) {
+            size_t child = 2 * root + 1;
+            if (child + 1 < num && index[child].id < index[child + 1].id) {
+                child++;
+            }
+            if (index[root].id >= index[child].id) {
+                break;
+            }
+            TsIdIndexEntry tmp = index[root];
+            index[root] = index[child];
+            index[child] = tmp;
+            root = child;
+        }
+    }
+
+    // move largest element to the end and restore heap property for remaining elements
+    for (size_t end = num - 1; end > 0; end--) {
+        TsIdIndexEntry tmp = index[0];
+        index[0] = index[end];
+        index[end] = tmp;
+
+        size_t root = 0;
+        while (2 * root + 1 < end) {
+            size_t child = 2 * root + 1;
+            if (child + 1 < end && index[child].id < index[child + 1].id) {
+                child++;
+            }
+            if (index[root].id >= index[child].id) {
+                break;
+            }
+            tmp = index[root];
+            index[root] = index[child];
+            index[child] = tmp;
+            root = child;
+        }
+    }
+}
+
+/*
+ * Returns the position of the node with given ID in the data_nodes array or -1 if not found
+ */
+static int _id_index_search(const TsIdIndexEntry *index, size_t num, node_id_t id)
+{
+    size_t low = 0;
+    size_t high = num;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (index[mid].id < id) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+    if (low < num && index[low].id == id) {
+        return index[low].pos;
+    }
+    return -1;
+}
+
+/*
+ * Fibonacci hashing of a node ID (shift = 32 - number of bits of the hash table size)
+ */
+static inline size_t _id_hash_slot(node_id_t id, uint8_t shift)
+{
+    return (uint32_t)(id * 2654435769U) >> shift;
+}
+
+/*
+ * Calculates 32-bit FNV-1a hash of a string
+ */
+static uint32_t _fnv1a(const char *str, size_t len)
+{
+    uint32_t hash = 2166136261U;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)str[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+/*
+ * Calculates length and 8-bit hash (folded FNV-1a) of a node name
+ */
+static TsNameInfo _name_info(const char *name, size_t len)
+{
+    uint32_t hash = _fnv1a(name, len);
+    hash ^= hash >> 16;
+    hash ^= hash >> 8;
+
+    TsNameInfo info;
+    info.len = (len < UINT8_MAX) ? len : UINT8_MAX;
+    info.hash = (uint8_t)hash;
+    return info;
+}
+
+/*
+ * Calculates the checksum of the node IDs, parents and names stored in TsNodeIndex to detect
+ * outdated lookup tables
+ */
+static uint32_t _nodes_checksum(const DataNode *data, size_t num)
+{
+    uint32_t hash = 2166136261U;
+    for (size_t i = 0; i < num; i++) {
+        // independent of byte order and ID size, as the tables are generated on a host
+        uint32_t ids[2] = { data[i].id, data[i].parent };
+        for (size_t j = 0; j < 8; j++) {
+            hash ^= (uint8_t)(ids[j / 4] >> (8 * (j % 4)));
+            hash *= 16777619U;
+        }
+        // null termination included to separate the names
+        for (const char *c = data[i].name; ; c++) {
+            hash ^= (uint8_t)*c;
+            hash *= 16777619U;
+            if (*c == '\0') {
+                break;
+            }
+        }
+    }
+    return hash;
+}
+
+/*
+ * Returns channel number if pub_ch contains exactly one channel, otherwise -1
+ */
+static int _pub_channel(uint16_t pub_ch)
+{
+    if (pub_ch == 0 || (pub_ch & (pub_ch - 1)) != 0) {
+        return -1;
+    }
+    int ch = 0;
+    while ((pub_ch & 1U) == 0) {
+        pub_ch >>= 1;
+        ch++;
+    }
+    return ch;
 }
 
 ThingSet::ThingSet(DataNode *data, size_t num)
 {
-    _check_id_duplicates(data, num);
+    arrlen_autodetected = _count_array_elements(data, num);
+
+    data_nodes = data;
+    num_nodes = num;
+
+    build_id_index();
+    build_id_hash();
+    build_child_index();
+    update_pub_index();
+
+    check_id_duplicates();
+}
 
-    _count_array_elements(data, num);
+ThingSet::ThingSet(DataNode *data, size_t num, const TsNodeIndex &index)
+{
+    // not covered by the checksum, so also needed if the tables are used
+    arrlen_autodetected = _count_array_elements(data, num);
 
     data_nodes = data;
     num_nodes = num;
+
+    if (index.num_nodes == num && index.checksum == _nodes_checksum(data, num)) {
+        // lookups by ID use the index instead of the hash table
+        id_index = index.id_index;
+        children = index.children;
+        child_start = index.child_start;
+        name_info = index.name_info;
+    }
+    else {
+        // outdated tables
+        build_id_index();
+        build_id_hash();
+        build_child_index();
+    }
+    update_pub_index();
+
+    check_id_duplicates();
+}
+
+ThingSet::~ThingSet()
+{
+    disable_pub_delta(0xFFFF);
+    disable_pub_template(0xFFFF);
+    free_pub_index();
+#if TS_NODE_ID_HASH_TABLE
+    free(id_hash);
+#endif
+
+    if (index_allocated) {
+        free((void *)id_index);
+        free((void *)children);
+        free((void *)child_start);
+        free((void *)name_info);
+    }
+}
+
+void ThingSet::build_id_index()
+{
+    if (num_nodes == 0 || num_nodes > (node_pos_t)-1) {
+        return;     // positions can't be stored in node_pos_t, use linear search
+    }
+
+    TsIdIndexEntry *index = (TsIdIndexEntry *)malloc(num_nodes * sizeof(TsIdIndexEntry));
+    if (index == NULL) {
+        return;
+    }
+
+    for (unsigned int i = 0; i < num_nodes; i++) {
+        index[i].id = data_nodes[i].id;
+        index[i].pos = i;
+    }
+    _sort_id_index(index, num_nodes);
+
+    id_index = index;
+    index_allocated = true;
+}
+
+void ThingSet::build_id_hash()
+{
+#if TS_NODE_ID_HASH_TABLE
+    if (num_nodes == 0 || num_nodes > (node_pos_t)-1) {
+        return;     // positions can't be stored in node_pos_t
+    }
+
+    uint8_t bits = 1;
+    while (((size_t)1 << bits) < 2 * num_nodes) {
+        bits++;
+    }
+    size_t mask = ((size_t)1 << bits) - 1;
+
+    TsIdIndexEntry *table = (TsIdIndexEntry *)calloc(mask + 1, sizeof(TsIdIndexEntry));
+    if (table == NULL) {
+        return;
+    }
+
+    id_hash_shift = 32 - bits;
+    for (unsigned int i = 0; i < num_nodes; i++) {
+        if (data_nodes[i].id == 0) {
+            continue;   // invalid ID, used to mark empty slots
+        }
+        size_t slot = _id_hash_slot(data_nodes[i].id, id_hash_shift);
+        while (table[slot].id != 0) {
+            slot = (slot + 1) & mask;
+        }
+        table[slot].id = data_nodes[i].id;
+        table[slot].pos = i;
+    }
+    id_hash = table;
+#endif
+}
+
+int ThingSet::find_node_pos(node_id_t id)
+{
+#if TS_NODE_ID_HASH_TABLE
+    if (id_hash != NULL && id != 0) {
+        size_t mask = ((size_t)1 << (32 - id_hash_shift)) - 1;
+        size_t slot = _id_hash_slot(id, id_hash_shift);
+        while (id_hash[slot].id != 0) {
+            if (id_hash[slot].id == id) {
+                return id_hash[slot].pos;
+            }
+            slot = (slot + 1) & mask;
+        }
+        return -1;
+    }
+#endif
+
+    if (id_index != NULL) {
+        return _id_index_search(id_index, num_nodes, id);
+    }
+
+    for (unsigned int i = 0; i < num_nodes; i++) {
+        if (data_nodes[i].id == id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+size_t ThingSet::name_len(const DataNode *node)
+{
+    if (name_info != NULL && node >= data_nodes && node < data_nodes + num_nodes) {
+        size_t len = name_info[node - data_nodes].len;
+        if (len < UINT8_MAX) {
+            return len;
+        }
+    }
+    return strlen(node->name);
+}
+
+void ThingSet::check_id_duplicates()
+{
+    if (num_nodes > (node_pos_t)-1) {
+        // no index possible, see build_id_index()
+        init_status = TS_STATUS_NOT_IMPLEMENTED;
+        return;
+    }
+    else if (id_index == NULL) {
+        // index allocation failed
+        init_status = (num_nodes > 0) ? TS_STATUS_INTERNAL_SERVER_ERR : TS_STATUS_VALID;
+        return;
+    }
+
+    // duplicates are next to each other in the sorted index
+    for (unsigned int i = 1; i < num_nodes; i++) {
+        if (id_index[i].id == id_index[i - 1].id) {
+            init_status = TS_STATUS_CONFLICT;
+            conflicting_id = id_index[i].id;
+            return;
+        }
+    }
+    init_status = TS_STATUS_VALID;
+}
+
+size_t ThingSet::child_slot(node_id_t parent_id)
+{
+    if (parent_id == 0) {
+        return num_nodes;
+    }
+    int pos = find_node_pos(parent_id);
+    return (pos >= 0) ? (size_t)pos : num_nodes + 1;
+}
+
+void ThingSet::build_child_index()
+{
+    if (id_index == NULL) {
+        return;
+    }
+
+    node_pos_t *list = (node_pos_t *)malloc(num_nodes * sizeof(node_pos_t));
+    node_pos_t *start = (node_pos_t *)calloc(num_nodes + 3, sizeof(node_pos_t));
+    TsNameInfo *names = (TsNameInfo *)malloc(num_nodes * sizeof(TsNameInfo));
+    if (list == NULL || start == NULL || names == NULL) {
+        free(list);
+        free(start);
+        free(names);
+        return;
+    }
+
+    // count children per slot and calculate start of each slot
+    for (unsigned int i = 0; i < num_nodes; i++) {
+        start[child_slot(data_nodes[i].parent) + 1]++;
+        names[i] = _name_info(data_nodes[i].name, strlen(data_nodes[i].name));
+    }
+    for (unsigned int slot = 1; slot < num_nodes + 3; slot++) {
+        start[slot] += start[slot - 1];
+    }
+
+    // fill children table (start is temporarily used as fill pointer, so that it contains the
+    // end of each slot afterwards)
+    for (unsigned int i = 0; i < num_nodes; i++) {
+        list[start[child_slot(data_nodes[i].parent)]++] = i;
+    }
+    for (unsigned int slot = num_nodes + 2; slot > 0; slot--) {
+        start[slot] = start[slot - 1];
+    }
+    start[0] = 0;
+
+    children = list;
+    child_start = start;
+    name_info = names;
+}
+
+DataNode *ThingSet::first_child(ChildIterator &it, node_id_t parent_id)
+{
+    it.parent_id = parent_id;
+    if (children != NULL) {
+        size_t slot = child_slot(parent_id);
+        it.pos = child_start[slot];
+        it.end = child_start[slot + 1];
+    }
+    else {
+        it.pos = 0;
+        it.end = num_nodes;
+    }
+    return next_child(it);
+}
+
+DataNode *ThingSet::next_child(ChildIterator &it)
+{
+    while (it.pos < it.end) {
+        // parent has to be checked for nodes without index and for orphaned nodes
+        DataNode *node = &data_nodes[(children != NULL) ? children[it.pos] : it.pos];
+        it.pos++;
+        if (node->parent == it.parent_id) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+size_t ThingSet::num_children(node_id_t parent_id)
+{
+    if (children != NULL) {
+        size_t slot = child_slot(parent_id);
+        if (slot < num_nodes + 1) {
+            return child_start[slot + 1] - child_start[slot];
+        }
+    }
+
+    size_t count = 0;
+    ChildIterator it;
+    for (DataNode *node = first_child(it, parent_id); node != NULL; node = next_child(it)) {
+        count++;
+    }
+    return count;
+}
+
+void ThingSet::free_pub_index()
+{
+    free(pub_bits);
+    pub_bits = NULL;
+    pub_words = 0;
+}
+
+void ThingSet::update_pub_index()
+{
+    request_full_pub(0xFFFF);
+    for (int ch = 0; ch < 16; ch++) {
+        if (pub_template[ch] != NULL) {
+            pub_template[ch]->valid = false;
+        }
+    }
+
+    if (num_nodes == 0) {
+        return;
+    }
+
+    if (pub_bits == NULL) {
+        // allocated only once, so that set_pubsub never moves the sets
+        pub_words = (num_nodes + 31) / 32;
+        pub_bits = (uint32_t *)malloc(16 * pub_words * sizeof(uint32_t));
+        if (pub_bits == NULL) {
+            pub_words = 0;
+            return;     // scan all nodes
+        }
+    }
+
+    // single pass over the data nodes, each word is written only once, so a concurrent
+    // publication sees either the old or the new flags of a node
+    size_t count[16] = {};
+    for (size_t w = 0; w < pub_words; w++) {
+        uint32_t words[16] = {};
+        for (size_t i = w * 32; i < num_nodes && i < (w + 1) * 32; i++) {
+            for (uint32_t flags = data_nodes[i].pubsub; flags != 0; flags &= flags - 1) {
+                words[__builtin_ctz(flags)] |= 1U << (i % 32);
+            }
+        }
+        for (int ch = 0; ch < 16; ch++) {
+            pub_bits[ch * pub_words + w] = words[ch];
+            count[ch] += __builtin_popcount(words[ch]);
+        }
+    }
+    memcpy(pub_count, count, sizeof(pub_count));
+}
+
+/*
+ * Calculates a 32-bit snapshot of the value of a node to detect changes
+ *
+ * Values with up to 32 bits are stored directly, longer values are hashed.
+ */
+static uint32_t _value_snapshot(const DataNode *node)
+{
+    uint32_t value = 0;
+    switch (node->type) {
+    case TS_T_BOOL:
+        return *((bool *)node->data);
+    case TS_T_UINT16:
+    case TS_T_INT16:
+        return *((uint16_t *)node->data);
+    case TS_T_UINT32:
+    case TS_T_INT32:
+    case TS_T_FLOAT32:
+        memcpy(&value, node->data, sizeof(value));
+        return value;
+    case TS_T_UINT64:
+    case TS_T_INT64:
+        return _fnv1a((const char *)node->data, sizeof(uint64_t));
+    case TS_T_STRING:
+        return _fnv1a((const char *)node->data, strlen((const char *)node->data));
+    case TS_T_BYTES: {
+        TsBytesBuffer *bytes = (TsBytesBuffer *)node->data;
+        return _fnv1a((const char *)bytes->bytes, bytes->num_bytes) ^ bytes->num_bytes;
+    }
+    case TS_T_ARRAY: {
+        ArrayInfo *array_info = (ArrayInfo *)node->data;
+        if (array_info == NULL) {
+            return 0;
+        }
+        size_t elem_size;
+        switch (array_info->type) {
+        case TS_T_UINT64:
+        case TS_T_INT64:
+            elem_size = 8;
+            break;
+        case TS_T_UINT32:
+        case TS_T_INT32:
+        case TS_T_FLOAT32:
+            elem_size = 4;
+            break;
+        case TS_T_UINT16:
+        case TS_T_INT16:
+            elem_size = 2;
+            break;
+        case TS_T_NODE_ID:
+            elem_size = sizeof(node_id_t);
+            break;
+        default:
+            elem_size = 0;
+            break;
+        }
+        return _fnv1a((const char *)array_info->ptr, array_info->num_elements * elem_size) ^
+            array_info->num_elements;
+    }
+    default:
+        return 0;
+    }
+}
+
+bool ThingSet::enable_pub_delta(uint16_t pub_ch, uint16_t refresh_interval)
+{
+    int ch = _pub_channel(pub_ch);
+    if (ch < 0) {
+        return false;
+    }
+    if (pub_delta[ch] == NULL) {
+        pub_delta[ch] = (PubDelta *)calloc(1, sizeof(PubDelta));
+        if (pub_delta[ch] == NULL) {
+            return false;
+        }
+    }
+    pub_delta[ch]->refresh_interval = refresh_interval;
+    pub_delta[ch]->full = true;
+    return true;
+}
+
+void ThingSet::disable_pub_delta(uint16_t pub_ch)
+{
+    for (int ch = 0; ch < 16; ch++) {
+        if ((pub_ch & (1U << ch)) && pub_delta[ch] != NULL) {
+            free(pub_delta[ch]->snapshots);
+            free(pub_delta[ch]->positions);
+            free(pub_delta[ch]->selected);
+            free(pub_delta[ch]);
+            pub_delta[ch] = NULL;
+        }
+    }
+}
+
+void ThingSet::request_full_pub(uint16_t pub_ch)
+{
+    for (int ch = 0; ch < 16; ch++) {
+        if ((pub_ch & (1U << ch)) && pub_delta[ch] != NULL) {
+            pub_delta[ch]->full = true;
+        }
+    }
+}
+
+const uint8_t *ThingSet::select_pub_delta(uint16_t pub_ch, size_t &count, bool update)
+{
+    int ch = _pub_channel(pub_ch);
+    PubDelta *delta = (ch >= 0) ? pub_delta[ch] : NULL;
+    if (delta == NULL) {
+        return NULL;
+    }
+
+    size_t num = num_pub_nodes(pub_ch);
+    if (num != delta->num_nodes || delta->selected == NULL) {
+        // nodes were added or removed by the application (or first message)
+        // one additional element, as realloc may return NULL for size 0
+        uint32_t *snapshots = (uint32_t *)realloc(delta->snapshots,
+            (num + 1) * sizeof(uint32_t));
+        uint32_t *positions = (uint32_t *)realloc(delta->positions,
+            (num + 1) * sizeof(uint32_t));
+        uint8_t *selected = (uint8_t *)realloc(delta->selected, num / 8 + 1);
+        if (snapshots != NULL) {
+            delta->snapshots = snapshots;
+        }
+        if (positions != NULL) {
+            delta->positions = positions;
+        }
+        if (selected != NULL) {
+            delta->selected = selected;
+        }
+        if (snapshots == NULL || positions == NULL || selected == NULL) {
+            disable_pub_delta(pub_ch);
+            return NULL;
+        }
+        delta->num_nodes = num;
+        delta->full = true;
+    }
+
+    bool full = delta->full ||
+        (delta->refresh_interval > 0 && delta->cycle + 1 >= delta->refresh_interval);
+
+    count = 0;
+    memset(delta->selected, 0, num / 8 + 1);
+    PubIterator it;
+    size_t i = 0;
+    for (DataNode *node = first_pub_node(it, pub_ch); node != NULL && i < num;
+            node = next_pub_node(it), i++) {
+        // snapshots are only compared with the same node, even if the nodes of the channel
+        // changed without any notification
+        uint32_t snapshot = _value_snapshot(node);
+        uint32_t pos = node - data_nodes;
+        if (full || pos != delta->positions[i] || snapshot != delta->snapshots[i]) {
+            delta->selected[i / 8] |= 1U << (i % 8);
+            count++;
+        }
+        if (update) {
+            delta->snapshots[i] = snapshot;
+            delta->positions[i] = pos;
+        }
+    }
+
+    if (update) {
+        delta->cycle = full ? 0 : delta->cycle + 1;
+        delta->full = false;
+    }
+    return delta->selected;
+}
+
+bool ThingSet::pub_delta_selected(const uint8_t *selected, size_t index)
+{
+    return selected == NULL || (selected[index / 8] & (1U << (index % 8)));
+}
+
+bool ThingSet::enable_pub_template(uint16_t pub_ch)
+{
+    int ch = _pub_channel(pub_ch);
+    if (ch < 0) {
+        return false;
+    }
+    if (pub_template[ch] == NULL) {
+        pub_template[ch] = (PubTemplate *)calloc(1, sizeof(PubTemplate));
+        if (pub_template[ch] == NULL) {
+            return false;
+        }
+    }
+    if (!render_pub_template(pub_template[ch], pub_ch)) {
+        disable_pub_template(pub_ch);
+        return false;
+    }
+    return true;
+}
+
+ThingSet::PubTemplate *ThingSet::valid_pub_template(uint16_t pub_ch)
+{
+    int ch = _pub_channel(pub_ch);
+    PubTemplate *tpl = (ch >= 0) ? pub_template[ch] : NULL;
+    if (tpl != NULL && !tpl->valid && !render_pub_template(tpl, pub_ch)) {
+        return NULL;
+    }
+    return tpl;
+}
+
+void ThingSet::disable_pub_template(uint16_t pub_ch)
+{
+    for (int ch = 0; ch < 16; ch++) {
+        if ((pub_ch & (1U << ch)) && pub_template[ch] != NULL) {
+            free(pub_template[ch]->text);
+            free(pub_template[ch]->nodes);
+            free(pub_template[ch]->text_end);
+            free(pub_template[ch]);
+            pub_template[ch] = NULL;
+        }
+    }
+}
+
+void ThingSet::set_pubsub(DataNode *node, uint16_t pubsub)
+{
+    uint16_t changed = node->pubsub ^ pubsub;
+    node->pubsub = pubsub;
+    request_full_pub(changed);
+    for (int ch = 0; ch < 16; ch++) {
+        if ((changed & (1U << ch)) && pub_template[ch] != NULL) {
+            pub_template[ch]->valid = false;
+        }
+    }
+
+    if (pub_bits == NULL) {
+        return;
+    }
+
+    size_t pos = node - data_nodes;
+    for (int ch = 0; ch < 16; ch++) {
+        if (changed & (1U << ch)) {
+            uint32_t *word = &pub_bits[ch * pub_words + pos / 32];
+            uint32_t mask = 1U << (pos % 32);
+            if ((pubsub & (1U << ch)) && !(*word & mask)) {
+                *word |= mask;
+                pub_count[ch]++;
+            }
+            else if (!(pubsub & (1U << ch)) && (*word & mask)) {
+                *word &= ~mask;
+                pub_count[ch]--;
+            }
+        }
+    }
+}
+
+DataNode *ThingSet::first_pub_node(PubIterator &it, uint16_t pub_ch, size_t start_pos)
+{
+    int ch = _pub_channel(pub_ch);
+    it.pub_ch = pub_ch;
+    it.bits = (pub_bits != NULL && ch >= 0) ? &pub_bits[ch * pub_words] : NULL;
+    it.pos = start_pos;
+    it.end = num_nodes;
+    return next_pub_node(it);
+}
+
+DataNode *ThingSet::next_pub_node(PubIterator &it)
+{
+    if (it.bits != NULL && it.pos < it.end) {
+        // skip nodes not published in the channel, 32 at a time (bits after the last node are 0)
+        size_t w = it.pos / 32;
+        size_t end_word = (it.end + 31) / 32;
+        uint32_t word = it.bits[w] & (0xFFFFFFFFU << (it.pos % 32));
+        while (word == 0) {
+            if (++w >= end_word) {
+                it.pos = it.end;
+                return NULL;
+            }
+            word = it.bits[w];
+        }
+        // the set is used without checking the flags, so that the number of nodes always
+        // matches pub_count
+        it.pos = w * 32 + __builtin_ctz(word);
+        return &data_nodes[it.pos++];
+    }
+
+    while (it.bits == NULL && it.pos < it.end) {
+        DataNode *node = &data_nodes[it.pos];
+        it.pos++;
+        if (node->pubsub & it.pub_ch) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+size_t ThingSet::num_pub_nodes(uint16_t pub_ch)
+{
+    int ch = _pub_channel(pub_ch);
+    if (pub_bits != NULL && ch >= 0) {
+        return pub_count[ch];
+    }
+
+    size_t count = 0;
+    PubIterator it;
+    for (DataNode *node = first_pub_node(it, pub_ch); node != NULL; node = next_pub_node(it)) {
+        count++;
+    }
+    return count;
+}
+
+void ThingSet::dump_index(const char *name)
+{
+    if (id_index == NULL || name_info == NULL) {
+        printf("ThingSet error: Node index not available.\n");
+        return;
+    }
+    else if (arrlen_autodetected) {
+        printf("ThingSet error: Node index not supported with TS_AUTODETECT_ARRLEN.\n");
+        return;
+    }
+
+    printf("/*\n * Node lookup tables for %s\n *\n", name);
+    printf(" * Generated by ThingSet::dump_index(), re-generate after any change of the nodes.\n");
+    printf(" */\n\n");
+
+    printf("constexpr TsIdIndexEntry %s_id_index[] = {", name);
+    for (unsigned int i = 0; i < num_nodes; i++) {
+        printf("%s{0x%X, %u},", (i % 6 == 0) ? "\n    " : " ", (unsigned int)id_index[i].id,
+            (unsigned int)id_index[i].pos);
+    }
+    printf("\n};\n\n");
+
+    printf("constexpr node_pos_t %s_children[] = {", name);
+    for (unsigned int i = 0; i < num_nodes; i++) {
+        printf("%s%u,", (i % 16 == 0) ? "\n    " : " ", (unsigned int)children[i]);
+    }
+    printf("\n};\n\n");
+
+    printf("constexpr node_pos_t %s_child_start[] = {", name);
+    for (unsigned int i = 0; i < num_nodes + 3; i++) {
+        printf("%s%u,", (i % 16 == 0) ? "\n    " : " ", (unsigned int)child_start[i]);
+    }
+    printf("\n};\n\n");
+
+    printf("constexpr TsNameInfo %s_name_info[] = {", name);
+    for (unsigned int i = 0; i < num_nodes; i++) {
+        printf("%s{%u, %u},", (i % 8 == 0) ? "\n    " : " ", name_info[i].len, name_info[i].hash);
+    }
+    printf("\n};\n\n");
+
+    printf("constexpr TsNodeIndex %s_index = {\n", name);
+    printf("    %u, 0x%08X,\n    %s_id_index, %s_children, %s_child_start, %s_name_info\n};\n\n",
+        (unsigned int)num_nodes, (unsigned int)_nodes_checksum(data_nodes, num_nodes), name, name,
+        name, name);
+
+    printf("TS_NODE_INDEX_CHECK(%s, %s_index);\n", name, name);
 }
 
 int ThingSet::process(uint8_t *request, size_t request_len, uint8_t *response, size_t response_size)
+{
+    Output out = {};
+    return process(request, request_len, response, response_size, out);
+}
+
+int ThingSet::process(uint8_t *request, size_t request_len, uint8_t *response,
+    size_t response_size, Output &out)
 {
     // check if proper request was set before asking for a response
     if (request == NULL || request_len < 1)
@@ -77,26 +886,124 @@ int ThingSet::process(uint8_t *request, size_t request_len, uint8_t *response, s
     req_len = request_len;
     resp = response;
     resp_size = response_size;
+    resp_out = &out;
 
+    int len = 0;
     if (req[0] < 0x20) {
         // binary mode request
-        return bin_process();
+        len = bin_process();
     }
     else if (req[0] == '?' || req[0] == '=' || req[0] == '+' || req[0] == '-' || req[0] == '!') {
         // text mode request
-        return txt_process();
+        len = txt_process();
     }
     else {
         // not a thingset command --> ignore and set response to empty string
         response[0] = 0;
+    }
+
+    resp_out = NULL;
+    return len;
+}
+
+int ThingSet::process(uint8_t *request, size_t request_len, uint8_t *buf, size_t buf_size,
+    TsStreamSink sink, void *ctx)
+{
+    Output out = {};
+    out.sink = sink;
+    out.ctx = ctx;
+
+    size_t len = process(request, request_len, buf, buf_size, out);
+    return (len > 0 && stream_flush(out, buf, len)) ? out.sent : 0;
+}
+
+int ThingSet::process_size(uint8_t *request, size_t request_len)
+{
+    // only requests without side effects can be measured
+    if (request == NULL || request_len < 1 ||
+        (request[0] != '?' && request[0] != TS_GET && request[0] != TS_FETCH))
+    {
         return 0;
     }
+
+    uint8_t buf[48];    // only used for status message and headers
+    Output out = {};
+    out.measure = true;
+
+    size_t len = process(request, request_len, buf, sizeof(buf), out);
+    return (len > 0) ? out.sent + len : 0;
+}
+
+int ThingSet::process(uint8_t *request, size_t request_len, TsIoVec *iov_buf, int iov_buf_max,
+    uint8_t *scratch, size_t scratch_size)
+{
+    Output out = {};
+    out.iov = iov_buf;
+    out.iov_max = iov_buf_max;
+    out.iov_mark = (const char *)scratch;
+
+    size_t len = process(request, request_len, scratch, scratch_size, out);
+    bool last = len > 0 && iov_add(out, out.iov_mark, (const char *)scratch + len - out.iov_mark);
+    return last ? out.iov_count : 0;
+}
+
+bool ThingSet::iov_add(Output &out, const void *base, size_t len)
+{
+    if (len == 0) {
+        return true;
+    }
+    if (out.iov_count > 0 &&
+        (const uint8_t *)out.iov[out.iov_count - 1].base + out.iov[out.iov_count - 1].len == base)
+    {
+        out.iov[out.iov_count - 1].len += len;
+        return true;
+    }
+    if (out.iov_count >= out.iov_max) {
+        return false;
+    }
+    out.iov[out.iov_count].base = base;
+    out.iov[out.iov_count].len = len;
+    out.iov_count++;
+    return true;
+}
+
+bool ThingSet::stream_flush(Output &out, uint8_t *buf, size_t &len)
+{
+    if (out.sink == NULL || len == 0 || out.sink(buf, len, out.ctx) != 0) {
+        return false;
+    }
+    out.sent += len;
+    len = 0;
+    return true;
 }
 
 DataNode *const ThingSet::get_node(const char *str, size_t len, int32_t parent)
 {
+    if (name_info != NULL) {
+        TsNameInfo info = _name_info(str, len);
+        size_t first = 0;
+        size_t last = num_nodes;
+        if (parent >= 0) {
+            size_t slot = child_slot(parent);
+            first = child_start[slot];
+            last = child_start[slot + 1];
+        }
+        for (size_t i = first; i < last; i++) {
+            // without parent, search in order of data_nodes array
+            node_pos_t pos = (parent >= 0) ? children[i] : i;
+            if (name_info[pos].len == info.len && name_info[pos].hash == info.hash
+                && strncmp(data_nodes[pos].name, str, len) == 0
+                && data_nodes[pos].name[len] == '\0'
+                && (parent < 0 || data_nodes[pos].parent == (node_id_t)parent))
+            {
+                return &(data_nodes[pos]);
+            }
+        }
+        return NULL;
+    }
+
     for (unsigned int i = 0; i < num_nodes; i++) {
-        if (parent != -1 && data_nodes[i].parent != parent) {
+        if (parent != -1 && data_nodes[i].parent != (node_id_t)parent) {
             continue;
         }
         else if (strncmp(data_nodes[i].name, str, len) == 0
@@ -110,43 +1017,97 @@ DataNode *const ThingSet::get_node(const char *str, size_t len, int32_t parent)
 
 DataNode *const ThingSet::get_node(node_id_t id)
 {
-    for (unsigned int i = 0; i < num_nodes; i++) {
-        if (data_nodes[i].id == id) {
-            return &(data_nodes[i]);
-        }
-    }
-    return NULL;
+    int pos = find_node_pos(id);
+    return (pos >= 0) ? &(data_nodes[pos]) : NULL;
 }
 
-DataNode *const ThingSet::get_endpoint(const char *path, size_t len)
+DataNode *ThingSet::resolve_path(const char *path, size_t len)
 {
-    DataNode *node;
     const char *start = path;
-    const char *end;
-    uint16_t parent = 0;
+    const char *path_end = path + len;
+    node_id_t parent = 0;
 
-    // maximum depth of 10 assumed
-    for (int i = 0; i < 10; i++) {
-        end = strchr(start, '/');
-        if (end == NULL || end >= path + len) {
+    while (true) {
+        const char *end = (const char *)memchr(start, '/', path_end - start);
+        if (end == NULL) {
             // we are at the end of the path
-            return get_node(start, path + len - start, parent);
+            return get_node(start, path_end - start, parent);
         }
-        else if (end == path + len - 1) {
+        else if (end == path_end - 1) {
             // path ends with slash
             return get_node(start, end - start, parent);
         }
         else {
             // go further down the path
-            node = get_node(start, end - start, parent);
-            if (node) {
-                parent = node->id;
-                start = end + 1;
-            }
-            else {
+            DataNode *node = get_node(start, end - start, parent);
+            if (node == NULL) {
                 return NULL;
             }
+            parent = node->id;
+            start = end + 1;
         }
     }
-    return NULL;
+}
+
+bool ThingSet::path_matches(const DataNode *node, const char *path, size_t len)
+{
+    if (len > 0 && path[len - 1] == '/') {
+        len--;      // ignore trailing slash
+    }
+
+    const char *end = path + len;
+    while (node != NULL) {
+        const char *start = end;
+        while (start > path && start[-1] != '/') {
+            start--;
+        }
+        if (strncmp(node->name, start, end - start) != 0 || node->name[end - start] != '\0') {
+            return false;
+        }
+        if (start == path) {
+            // first segment of the path must be a child of the root node
+            return node->parent == 0;
+        }
+        end = start - 1;
+        node = get_node(node->parent);
+    }
+    return false;
+}
+
+DataNode *const ThingSet::get_endpoint(const char *path, size_t len)
+{
+#if TS_PATH_CACHE_SIZE > 0
+    uint32_t hash = _fnv1a(path, len);
+    PathCacheEntry *lru = &path_cache[0];
+
+    path_cache_clock++;
+    for (int i = 0; i < TS_PATH_CACHE_SIZE; i++) {
+        PathCacheEntry *entry = &path_cache[i];
+        // read only once, as the entry may be replaced by a concurrent lookup
+        DataNode *node = entry->node;
+        if (node != NULL && entry->hash == hash && entry->len == len
+            && path_matches(node, path, len))
+        {
+            entry->last_used = path_cache_clock;
+            return node;
+        }
+        if (entry->node == NULL || (lru->node != NULL &&
+            (uint16_t)(path_cache_clock - entry->last_used) >
+            (uint16_t)(path_cache_clock - lru->last_used)))
+        {
+            lru = entry;
+        }
+    }
+
+    DataNode *node = resolve_path(path, len);
+    if (node != NULL && len <= UINT16_MAX) {
+        lru->node = node;
+        lru->hash = hash;
+        lru->len = len;
+        lru->last_used = path_cache_clock;
+    }
+    return node;
+#else
+    return resolve_path(path, len);
+#endif
 }
@@ -206,6 +206,12 @@ static inline void *_int16_to_void(int16_t *ptr) { return (void*) ptr; }
 #define TS_NODE_INT16(_id, _name, _data_ptr, _parent, _acc, _pubsub) \
     {_id, _parent, _name, _int16_to_void(_data_ptr), TS_T_INT16, 0, _acc, _pubsub}
 
+/*
+ * Number of digits for float nodes to use the shortest representation that is parsed back to the
+ * same value in text mode (e.g. 14.4 instead of 14.40) instead of a fixed number of decimals
+ */
+#define TS_FLOAT_SHORTEST (-1)
+
 static inline void *_float_to_void(float *ptr) { return (void*) ptr; }
 #define TS_NODE_FLOAT(_id, _name, _data_ptr, _digits, _parent, _acc, _pubsub) \
     {_id, _parent, _name, _float_to_void(_data_ptr), TS_T_FLOAT32, _digits, _acc, _pubsub}
@@ -266,8 +272,22 @@ static inline void *_array_to_void(ArrayInfo *ptr) { return (void *) ptr; }
 #define TS_ANY_RW       (TS_USR_RW | TS_EXP_RW | TS_MKR_RW)
 
 
+#if TS_32BIT_NODE_IDS
+typedef uint32_t node_id_t;
+
+/**
+ * Position of a data node inside the data_nodes array
+ */
+typedef uint32_t node_pos_t;
+#else
 typedef uint16_t node_id_t;
 
+/**
+ * Position of a data node inside the data_nodes array
+ */
+typedef uint16_t node_pos_t;
+#endif
+
 /**
  * ThingSet data node struct
  */
@@ -317,6 +337,100 @@ typedef struct DataNode {
 
 } DataNode;
 
+/**
+ * Entry of the node ID lookup table
+ *
+ * The table contains one entry per data node, sorted by ascending node ID, so that a node can be
+ * found by binary search.
+ */
+typedef struct {
+    node_id_t id;               ///< Node ID
+    node_pos_t pos;             ///< Position of the node in the data_nodes array
+} TsIdIndexEntry;
+
+/**
+ * Precomputed information about a node name to speed up name lookups
+ *
+ * Names are compared byte by byte only if length and hash match.
+ */
+typedef struct {
+    uint8_t len;                ///< Length of the name (UINT8_MAX for names >= 255 characters)
+    uint8_t hash;               ///< 8-bit hash of the name
+} TsNameInfo;
+
+/**
+ * Lookup tables to find data nodes by ID and by name without scanning the data_nodes array
+ *
+ * The tables are normally built by the ThingSet constructor and stored in RAM. For large data
+ * node trees, they can be generated in advance by ThingSet::dump_index() on a host computer and
+ * compiled into the firmware as constant data, so that they are stored in flash and the
+ * constructor only has to verify their checksum.
+ */
+typedef struct {
+    size_t num_nodes;                   ///< Number of nodes the tables were generated for
+    uint32_t checksum;                  ///< Checksum of the IDs, parents and names of the nodes
+    const TsIdIndexEntry *id_index;     ///< Node IDs sorted in ascending order
+    const node_pos_t *children;         ///< Node positions grouped by parent
+    const node_pos_t *child_start;      ///< Start of each group in children (num_nodes + 3)
+    const TsNameInfo *name_info;        ///< Name length and hash for each node
+} TsNodeIndex;
+
+/*
+ * Compile-time checks of node lookup tables generated by ThingSet::dump_index()
+ *
+ * The recursion splits the tables in halves to keep the recursion depth low enough for the
+ * constexpr limits of C++11 compilers also for large data node trees.
+ */
+constexpr bool _ts_ids_unique(const TsIdIndexEntry *index, size_t first, size_t last)
+{
+    return (last - first < 2) ||
+        (_ts_ids_unique(index, first, first + (last - first) / 2) &&
+        _ts_ids_unique(index, first + (last - first) / 2, last) &&
+        index[first + (last - first) / 2 - 1].id < index[first + (last - first) / 2].id);
+}
+
+constexpr bool _ts_orphans_found(const TsNodeIndex &index)
+{
+    return index.child_start[index.num_nodes + 2] != index.child_start[index.num_nodes + 1];
+}
+
+/**
+ * Check node lookup tables generated by ThingSet::dump_index() at compile time
+ *
+ * Compilation fails if the tables don't match the size of the data nodes array, if node IDs are
+ * not unique or if nodes reference a parent ID which does not exist.
+ *
+ * The contents of the data nodes array are not a constant expression, so changed IDs, parents or
+ * names with the same number of nodes can only be detected at runtime. The constructor compares
+ * the checksum of the tables with the data nodes and ignores outdated tables.
+ */
+#define TS_NODE_INDEX_CHECK(_data_nodes, _index) \
+    static_assert(sizeof(_data_nodes) / sizeof(DataNode) == (_index).num_nodes, \
+        "ThingSet node index does not match data nodes, run ThingSet::dump_index() again"); \
+    static_assert(_ts_ids_unique((_index).id_index, 0, (_index).num_nodes), \
+        "ThingSet data nodes contain duplicate IDs"); \
+    static_assert(!_ts_orphans_found(_index), \
+        "ThingSet data nodes reference a non-existing parent ID")
+
+/**
+ * Function receiving the chunks of a streamed response or publication message
+ *
+ * @param data Pointer to the chunk
+ * @param len Length of the chunk
+ * @param ctx Context pointer passed to the streaming function
+ *
+ * @returns 0 for success, any other value aborts the streaming
+ */
+typedef int (*TsStreamSink)(const uint8_t *data, size_t len, void *ctx);
+
+/**
+ * Fragment of a response generated in scatter-gather mode
+ */
+typedef struct {
+    const void *base;       ///< Pointer to the data (constant node name or scratch buffer)
+    size_t len;             ///< Length of the fragment
+} TsIoVec;
+
 /**
  * Main ThingSet class
  *
@@ -333,6 +447,53 @@ public:
      */
     ThingSet(DataNode *data, size_t num);
 
+    /**
+     * Initialize a ThingSet object with pre-generated node lookup tables
+     *
+     * If the lookup tables don't match the number, IDs, parents or names of the nodes, they are
+     * ignored and built at runtime. To detect this, a checksum of the IDs, parents and names of
+     * all nodes is calculated at startup. Arrays with TS_AUTODETECT_ARRLEN are counted in any
+     * case, even though dump_index() does not generate tables for such nodes.
+     *
+     * If the tables are used, nodes are found by ID via binary search (also if
+     * TS_NODE_ID_HASH_TABLE is enabled) and only the per-channel sets of published nodes are
+     * allocated (one bit per node and channel, see update_pub_index()).
+     *
+     * @param data Pointer to array of DataNode type containing the entire node database
+     * @param num Number of elements in that array
+     * @param index Lookup tables generated by dump_index()
+     */
+    ThingSet(DataNode *data, size_t num, const TsNodeIndex &index);
+
+    ~ThingSet();
+
+    ThingSet(const ThingSet &) = delete;
+    ThingSet &operator=(const ThingSet &) = delete;
+
+    /**
+     * Get the result of the consistency checks performed by the constructor
+     *
+     * @returns TS_STATUS_VALID if no errors were found, TS_STATUS_CONFLICT if the data nodes
+     *          contain duplicate IDs (see get_conflicting_id), TS_STATUS_NOT_IMPLEMENTED if the
+     *          node IDs were not checked because there are more than 65535 nodes without
+     *          TS_32BIT_NODE_IDS or TS_STATUS_INTERNAL_SERVER_ERR if the node IDs could not be
+     *          checked because the lookup tables could not be allocated
+     */
+    int get_status()
+    {
+        return init_status;
+    }
+
+    /**
+     * Get a node ID that is used by more than one data node
+     *
+     * @returns Node ID if get_status() returned TS_STATUS_CONFLICT, otherwise 0
+     */
+    node_id_t get_conflicting_id()
+    {
+        return conflicting_id;
+    }
+
     /**
      * Process ThingSet request
      *
@@ -347,6 +508,125 @@ public:
      */
     int process(uint8_t *request, size_t req_len, uint8_t *response, size_t resp_size);
 
+    /**
+     * Process ThingSet request and stream the response in chunks
+     *
+     * The response buffer is sent to the sink whenever the next data node does not fit into it
+     * anymore, so the buffer only needs to hold the status message and the largest single value.
+     * Streaming is supported for GET and FETCH requests in text and binary mode. All other
+     * responses are sent in one chunk.
+     *
+     * If an error occurs after the first chunk was sent, the response can't be changed to an
+     * error status anymore, so 0 is returned and the receiver has to discard the incomplete
+     * response.
+     *
+     * @param request Pointer to the ThingSet request buffer
+     * @param req_len Length of the data in the request buffer
+     * @param buf Pointer to the buffer used to assemble the chunks
+     * @param buf_size Size of the buffer, i.e. maximum length of a chunk
+     * @param sink Function to receive the chunks
+     * @param ctx Context pointer passed to the sink
+     *
+     * @returns Total length of the response sent to the sink or 0 in case of error
+     */
+    int process(uint8_t *request, size_t req_len, uint8_t *buf, size_t buf_size,
+        TsStreamSink sink, void *ctx);
+
+    /**
+     * Process ThingSet request and generate the response as a list of fragments
+     *
+     * Node names of text mode GET responses are referenced in place (usually in flash) instead
+     * of being copied, so that a DMA-capable interface can send the response without any
+     * intermediate copy. Everything else, e.g. the status message, the values and names shorter
+     * than TS_IOV_MIN_NAME_LEN, is written to the scratch buffer. All other responses consist of
+     * a single fragment in the scratch buffer.
+     *
+     * The fragments are only valid until the scratch buffer or the data nodes are changed.
+     *
+     * @param request Pointer to the ThingSet request buffer
+     * @param req_len Length of the data in the request buffer
+     * @param iov Array to store the fragments
+     * @param iov_max Maximum number of fragments
+     * @param scratch Pointer to the buffer for formatted data
+     * @param scratch_size Size of the scratch buffer
+     *
+     * @returns Number of fragments or 0 in case of error
+     */
+    int process(uint8_t *request, size_t req_len, TsIoVec *iov, int iov_max, uint8_t *scratch,
+        size_t scratch_size);
+
+    /**
+     * Calculate the exact length of the response to a ThingSet request without generating it
+     *
+     * The values are only measured, so the response buffer can be allocated or the transport
+     * fragmented before the response is generated by process(). Only GET and FETCH requests can
+     * be measured, as all other requests would modify data.
+     *
+     * @param request Pointer to the ThingSet request buffer
+     * @param req_len Length of the data in the request buffer
+     *
+     * @returns Length of the response (without null termination) or 0 if the request can't be
+     *          measured
+     */
+    int process_size(uint8_t *request, size_t req_len);
+
+    /**
+     * Set the buffer for text mode requests received in pieces (see feed)
+     *
+     * Any partly received request is discarded.
+     *
+     * @param buf Pointer to the buffer where the request is assembled
+     * @param size Size of the buffer (one byte is used for null termination)
+     */
+    void feed_init(uint8_t *buf, size_t size);
+
+    /**
+     * Process a text mode request as its bytes arrive, e.g. from a UART
+     *
+     * The bytes are appended to the buffer set with feed_init. The path is resolved as soon as it
+     * is complete and the JSON payload is parsed incrementally, so that the request can be
+     * dispatched immediately after the terminating newline was received.
+     *
+     * Bytes after the newline are not consumed and have to be fed again after the response to the
+     * current request was handled.
+     *
+     * @param data Pointer to the received bytes
+     * @param len Number of received bytes
+     * @param consumed Number of bytes consumed from data
+     * @param response Pointer to the response buffer
+     * @param response_size Size of the response buffer
+     *
+     * @returns Length of the response (without null termination) or 0 if the request is not yet
+     *          complete or not a ThingSet request
+     */
+    int feed(const uint8_t *data, size_t len, size_t &consumed, uint8_t *response,
+        size_t response_size);
+
+    /**
+     * Set the storage for the JSON tokens of text mode requests
+     *
+     * By default, each instance stores TS_NUM_JSON_TOKENS tokens internally. A buffer provided
+     * by the application allows larger requests (e.g. on gateways) and can be shared between
+     * several instances, as long as they don't process requests concurrently.
+     *
+     * @param buf Pointer to the token buffer (NULL to use the internal storage)
+     * @param num Number of tokens in the buffer
+     */
+    void set_json_tokens(jsmntok_t *buf, size_t num);
+
+    /**
+     * Count the JSON tokens in the payload of a text mode request without storing them
+     *
+     * Can be used to allocate a token buffer of exactly the right size for set_json_tokens
+     * before the request is processed.
+     *
+     * @param request Pointer to the ThingSet request buffer
+     * @param req_len Length of the data in the request buffer
+     *
+     * @returns Number of tokens or negative JSMN error code if the payload is not valid
+     */
+    static int count_json_tokens(const uint8_t *request, size_t req_len);
+
     /**
      * Print all data nodes as a structured JSON text to stdout
      *
@@ -358,6 +638,19 @@ public:
      */
     void dump_json(node_id_t node_id = 0, int level = 0);
 
+    /**
+     * Print the node lookup tables as C++ source code to stdout
+     *
+     * The generated code should be stored in a header file and included after the definition of
+     * the data nodes array. The tables can then be passed to the ThingSet constructor.
+     *
+     * No tables are generated if the length of an array was detected via TS_AUTODETECT_ARRLEN,
+     * as the lengths have to be known without any processing of the data nodes at startup.
+     *
+     * @param name Name of the data nodes array (used as prefix for the generated tables)
+     */
+    void dump_index(const char *name = "data_nodes");
+
     /**
      * Sets current authentication level
      *
@@ -382,6 +675,36 @@ public:
      */
     int txt_pub(char *buf, size_t size, const uint16_t pub_ch);
 
+    /**
+     * Generate publication message in JSON format and stream it in chunks
+     *
+     * @param buf Pointer to the buffer used to assemble the chunks
+     * @param size Size of the buffer, i.e. maximum length of a chunk
+     * @param pub_ch Flag to select publication channel (must match pubsub of data node)
+     * @param sink Function to receive the chunks
+     * @param ctx Context pointer passed to the sink
+     *
+     * @returns Total length of the message sent to the sink or 0 in case of error
+     */
+    int txt_pub(char *buf, size_t size, const uint16_t pub_ch, TsStreamSink sink, void *ctx);
+
+    /**
+     * Generate publication message in JSON format as a list of fragments
+     *
+     * Node names are referenced in place, only the values and names shorter than
+     * TS_IOV_MIN_NAME_LEN are written to the scratch buffer.
+     *
+     * @param iov Array to store the fragments
+     * @param iov_max Maximum number of fragments
+     * @param scratch Pointer to the buffer for formatted data
+     * @param scratch_size Size of the scratch buffer
+     * @param pub_ch Flag to select publication channel (must match pubsub of data node)
+     *
+     * @returns Number of fragments or 0 in case of error
+     */
+    int txt_pub(TsIoVec *iov, int iov_max, char *scratch, size_t scratch_size,
+        const uint16_t pub_ch);
+
     /**
      * Generate publication message in CBOR format
      *
@@ -393,6 +716,37 @@ public:
      */
     int bin_pub(uint8_t *buf, size_t size, const uint16_t pub_ch);
 
+    /**
+     * Generate publication message in CBOR format and stream it in chunks
+     *
+     * @param buf Pointer to the buffer used to assemble the chunks
+     * @param size Size of the buffer, i.e. maximum length of a chunk
+     * @param pub_ch Flag to select publication channel (must match pubsub of data node)
+     * @param sink Function to receive the chunks
+     * @param ctx Context pointer passed to the sink
+     *
+     * @returns Total length of the message sent to the sink or 0 in case of error
+     */
+    int bin_pub(uint8_t *buf, size_t size, const uint16_t pub_ch, TsStreamSink sink, void *ctx);
+
+    /**
+     * Calculate the exact length of a publication message in JSON format without generating it
+     *
+     * @param pub_ch Flag to select publication channel (must match pubsub of data node)
+     *
+     * @returns Length of the message (without null termination) or 0 in case of error
+     */
+    int txt_pub_size(const uint16_t pub_ch);
+
+    /**
+     * Calculate the exact length of a publication message in CBOR format without generating it
+     *
+     * @param pub_ch Flag to select publication channel (must match pubsub of data node)
+     *
+     * @returns Length of the message or 0 in case of error
+     */
+    int bin_pub_size(const uint16_t pub_ch);
+
     /**
      * Encode a publication message in CAN message format for supplied data node
      *
@@ -449,6 +803,13 @@ public:
     /**
      * Get the endpoint node of a provided path
      *
+     * Resolved paths are stored in a cache shared by all callers (see TS_PATH_CACHE_SIZE), so
+     * lookups modify the ThingSet object. The cache is not locked: Concurrent lookups, e.g. by
+     * process() called from different threads, may replace each other's entries or store a
+     * slightly wrong LRU state, but a cached node is only returned after it was verified to be
+     * the endpoint of the path, so the result is always correct. Set TS_PATH_CACHE_SIZE to 0 if
+     * lookups must not write to shared memory at all.
+     *
      * @param path Path with multiple node names separated by forward slash
      * @param len Length of the entire path
      *
@@ -456,13 +817,359 @@ public:
      */
     DataNode *const get_endpoint(const char *path, size_t len);
 
+    /**
+     * Rebuild the per-channel sets of published nodes
+     *
+     * Must be called if the pubsub flags of data nodes were changed directly by the application
+     * instead of using the ThingSet protocol or set_pubsub(). Until then, publication messages
+     * for a single channel still contain the previous set of nodes.
+     *
+     * The sets are allocated at the first call and afterwards only updated in place, so it is
+     * safe to call this function while another thread generates a publication message.
+     */
+    void update_pub_index();
+
+    /**
+     * Enable delta publication for a channel
+     *
+     * Publication messages of this channel (txt_pub and bin_pub) only contain the nodes whose
+     * values changed since the previous message. A compact snapshot of 4 bytes per published
+     * node is stored together with the position of the node to detect the changes. Values up to
+     * 32 bits are compared exactly, longer values (64-bit integers, strings, bytes and arrays)
+     * are compared by a hash. The list of nodes of a pub/sub node is not compared at all.
+     *
+     * The first message after enabling, after a change of the nodes in the channel (via the
+     * ThingSet protocol, set_pubsub() or update_pub_index()) or after a failed message always
+     * contains all nodes. If no node changed, no message is generated.
+     * CAN publication messages (bin_pub_can) are not affected.
+     *
+     * @param pub_ch Flag to select publication channel (exactly one bit)
+     * @param refresh_interval Publish all nodes in every n-th publication interval, i.e. call
+     *                         of txt_pub or bin_pub (0 for never)
+     *
+     * @returns True on success, false if pub_ch is invalid or memory could not be allocated
+     */
+    bool enable_pub_delta(uint16_t pub_ch, uint16_t refresh_interval);
+
+    /**
+     * Disable delta publication, so that all nodes are published in each message again
+     *
+     * @param pub_ch Flag(s) to select publication channel(s)
+     */
+    void disable_pub_delta(uint16_t pub_ch);
+
+    /**
+     * Publish all nodes in the next message of channels using delta publication
+     *
+     * Should be called e.g. after a client connected.
+     *
+     * @param pub_ch Flag(s) to select publication channel(s)
+     */
+    void request_full_pub(uint16_t pub_ch);
+
+    /**
+     * Enable pre-rendered publication messages in JSON format for a channel
+     *
+     * The constant parts of the message (header and quoted node names) are rendered once and
+     * stored in a template, so that txt_pub only has to format the values. The template is
+     * rendered again automatically if the nodes of the channel are changed.
+     *
+     * The template is not used for delta publication, streaming or scatter-gather output.
+     *
+     * @param pub_ch Flag to select publication channel (exactly one bit)
+     *
+     * @returns True on success, false if pub_ch is invalid or memory could not be allocated
+     */
+    bool enable_pub_template(uint16_t pub_ch);
+
+    /**
+     * Disable pre-rendered publication messages and free the memory of the template
+     *
+     * @param pub_ch Flag(s) to select publication channel(s)
+     */
+    void disable_pub_template(uint16_t pub_ch);
+
 private:
+    /**
+     * Build the lookup table used by get_node(node_id_t)
+     *
+     * If the table cannot be allocated, get_node falls back to a linear search.
+     */
+    void build_id_index();
+
+    /**
+     * Build the hash table used by get_node(node_id_t) if TS_NODE_ID_HASH_TABLE is enabled
+     *
+     * If the table cannot be allocated, the ID index is used instead.
+     */
+    void build_id_hash();
+
+    /**
+     * Get the position of a data node in the data_nodes array
+     *
+     * @param id Node ID
+     *
+     * @returns Position or -1 if node is not found
+     */
+    int find_node_pos(node_id_t id);
+
+    /**
+     * Get the length of a data node name
+     *
+     * The length cached in name_info is used if available, so that keys can be serialized with
+     * memcpy instead of strlen and string formatting.
+     *
+     * @param node Pointer to the data node
+     *
+     * @returns Length of the name without null termination
+     */
+    size_t name_len(const DataNode *node);
+
+    /**
+     * Build the tables used by get_node(const char *, size_t, int32_t) to find the children of a
+     * node without scanning the entire data_nodes array
+     *
+     * Requires the ID index. If the tables cannot be allocated, get_node falls back to a linear
+     * search.
+     */
+    void build_child_index();
+
+    /**
+     * Check the data nodes for duplicate IDs using the ID index and set the status accordingly
+     */
+    void check_id_duplicates();
+
+    /**
+     * Determine the slot in the child_start table for the children of the given parent
+     *
+     * Slot num_nodes contains the children of the root node (ID 0), slot num_nodes + 1 all
+     * nodes with a parent ID which does not exist in the data_nodes array.
+     *
+     * @param parent_id ID of the parent node
+     *
+     * @returns Slot in child_start table
+     */
+    size_t child_slot(node_id_t parent_id);
+
+    /**
+     * Iterator over the child nodes of a parent node
+     */
+    typedef struct {
+        size_t pos;             ///< Next position in children table (or data_nodes w/o index)
+        size_t end;             ///< End position
+        node_id_t parent_id;    ///< ID of the parent node
+    } ChildIterator;
+
+    /**
+     * Get first child node of a parent node and initialize the iterator
+     *
+     * Child nodes are returned in the same order as they appear in the data_nodes array.
+     *
+     * @param it Iterator to be used with next_child()
+     * @param parent_id ID of the parent node (0 for root)
+     *
+     * @returns Pointer to data node or NULL if no child nodes exist
+     */
+    DataNode *first_child(ChildIterator &it, node_id_t parent_id);
+
+    /**
+     * Get next child node
+     *
+     * @param it Iterator initialized by first_child()
+     *
+     * @returns Pointer to data node or NULL if no more child nodes exist
+     */
+    DataNode *next_child(ChildIterator &it);
+
+    /**
+     * Get number of child nodes of a parent node
+     *
+     * @param parent_id ID of the parent node (0 for root)
+     */
+    size_t num_children(node_id_t parent_id);
+
+    /**
+     * Free the per-channel sets of published nodes, so that publication functions fall back to
+     * scanning the data_nodes array
+     */
+    void free_pub_index();
+
+    /**
+     * Change the pubsub flags of a node and update the per-channel sets accordingly
+     *
+     * The sets are updated in place without allocating memory.
+     *
+     * @param node Data node to be updated
+     * @param pubsub New pubsub flags
+     */
+    void set_pubsub(DataNode *node, uint16_t pubsub);
+
+    /**
+     * Iterator over the nodes published in a channel
+     */
+    typedef struct {
+        size_t pos;             ///< Next position in data_nodes
+        size_t end;             ///< End position
+        const uint32_t *bits;   ///< Bit set of the channel or NULL if all nodes are checked
+        uint16_t pub_ch;        ///< Publication channel flags
+    } PubIterator;
+
+    /**
+     * Get first node published in the given channel(s) and initialize the iterator
+     *
+     * Nodes are returned in the same order as they appear in the data_nodes array. The channel
+     * sets are only used if pub_ch contains a single channel, otherwise all nodes are scanned.
+     *
+     * @param it Iterator to be used with next_pub_node()
+     * @param pub_ch Publication channel flags
+     * @param start_pos Position in data_nodes where to start searching
+     *
+     * @returns Pointer to data node or NULL if no node is published in this channel
+     */
+    DataNode *first_pub_node(PubIterator &it, uint16_t pub_ch, size_t start_pos = 0);
+
+    /**
+     * Get next node published in the channel(s) of the iterator
+     *
+     * @param it Iterator initialized by first_pub_node()
+     *
+     * @returns Pointer to data node or NULL if no more nodes are published in this channel
+     */
+    DataNode *next_pub_node(PubIterator &it);
+
+    /**
+     * Get number of nodes published in the given channel(s)
+     *
+     * Takes constant time if pub_ch contains a single channel and the channel sets are available.
+     *
+     * @param pub_ch Publication channel flags
+     */
+    size_t num_pub_nodes(uint16_t pub_ch);
+
+    /**
+     * Select the nodes to be published in the next message of a channel in delta mode
+     *
+     * @param pub_ch Publication channel flags
+     * @param count Number of selected nodes (only set in delta mode)
+     * @param update Update the snapshots of the selected nodes (false in measure mode)
+     *
+     * @returns Bit set with selected nodes in the order of the channel (NULL if all nodes have
+     *          to be published, i.e. delta mode is not enabled)
+     */
+    const uint8_t *select_pub_delta(uint16_t pub_ch, size_t &count, bool update);
+
+    /**
+     * Pre-rendered publication message in JSON format
+     */
+    typedef struct {
+        char *text;                 ///< Message header followed by the quoted names with colon
+        DataNode **nodes;           ///< Nodes of the channel
+        size_t *text_end;           ///< End of the text in front of the value of each node
+        size_t num_nodes;           ///< Number of nodes in the channel
+        bool valid;                 ///< False if the nodes of the channel were changed
+    } PubTemplate;
+
+    /**
+     * Render the constant parts of a publication message template (see enable_pub_template)
+     *
+     * @param tpl Template to be filled
+     * @param pub_ch Publication channel flags
+     *
+     * @returns True on success, false if memory could not be allocated
+     */
+    bool render_pub_template(PubTemplate *tpl, uint16_t pub_ch);
+
+    /**
+     * Get the publication message template of a channel, rendered again if it is outdated
+     *
+     * @param pub_ch Flag to select publication channel (exactly one bit)
+     *
+     * @returns Pointer to the template or NULL if no valid template is available
+     */
+    PubTemplate *valid_pub_template(uint16_t pub_ch);
+
+    /**
+     * Generate publication message in JSON format using the template of the channel
+     *
+     * @param buf Pointer to the buffer where the publication message should be stored
+     * @param size Size of the message buffer, i.e. maximum allowed length of the message
+     * @param pub_ch Flag to select publication channel (must match pubsub of data node)
+     *
+     * @returns Actual length of the message, 0 in case of error or -1 if the template can't be
+     *          used
+     */
+    int txt_pub_template(char *buf, size_t size, uint16_t pub_ch);
+
+    /**
+     * Check if a node was selected by select_pub_delta
+     *
+     * @param selected Bit set returned by select_pub_delta
+     * @param index Index of the node in the channel
+     */
+    static bool pub_delta_selected(const uint8_t *selected, size_t index);
+
+    /**
+     * Resolve a path segment by segment (without using the path cache)
+     *
+     * @param path Path with multiple node names separated by forward slash
+     * @param len Length of the entire path
+     *
+     * @returns Pointer to data node or NULL if node is not found
+     */
+    DataNode *resolve_path(const char *path, size_t len);
+
+    /**
+     * Check if a node is the endpoint of the given path by comparing the names of the node and
+     * its parents with the path segments from the end
+     *
+     * @param node Pointer to data node
+     * @param path Path with multiple node names separated by forward slash
+     * @param len Length of the entire path
+     *
+     * @returns True if the path leads to the node
+     */
+    bool path_matches(const DataNode *node, const char *path, size_t len);
+
     /**
      * Prepares JSMN parser, performs initial check of payload data and calls get/fetch/patch
      * functions
      */
     int txt_process();
 
+    /**
+     * Performs initial check of payload data already parsed into tokens and calls
+     * get/fetch/patch functions
+     *
+     * @param endpoint Endpoint node of the request path (NULL if not found)
+     * @param path_len Length of the request path
+     */
+    int txt_dispatch(const DataNode *endpoint, int path_len);
+
+    /**
+     * Resolves the path and continues parsing the payload of a request received in pieces
+     *
+     * @param start Position of the first newly received byte in the request buffer
+     */
+    void feed_parse(size_t start);
+
+    /**
+     * Runs the JSMN parser with the currently configured token storage
+     *
+     * @param parser Parser state (initialized or from a previous run with less data)
+     * @param js Pointer to the JSON string
+     * @param len Length of the JSON string
+     *
+     * @returns Number of tokens or negative JSMN error code
+     */
+    int json_parse(jsmn_parser *parser, const char *js, size_t len);
+
+    /**
+     * Resolves the path of a request received in pieces and initializes the parser
+     *
+     * @param path_len Length of the request path
+     */
+    void feed_path(int path_len);
+
     /**
      * Performs initial check of payload data and calls get/fetch/patch functions
      */
@@ -542,6 +1249,77 @@ private:
      */
     int bin_exec(const DataNode *node, unsigned int pos_payload);
 
+    /**
+     * Destination of a response or publication message
+     *
+     * Created by each call of a process or pub function and passed down to the serialization
+     * functions, so that messages can be generated from different threads at the same time.
+     */
+    typedef struct {
+        TsStreamSink sink;      ///< Sink for streamed messages (NULL if not streaming)
+        void *ctx;              ///< Context pointer passed to the stream sink
+        size_t sent;            ///< Bytes already sent to the sink or counted in measure mode
+        bool measure;           ///< True if the length of the message is only measured
+        TsIoVec *iov;           ///< Fragments of a scatter-gather message (NULL if not used)
+        int iov_max;            ///< Maximum number of fragments in iov
+        int iov_count;          ///< Current number of fragments in iov
+        const char *iov_mark;   ///< Start of scratch buffer data not yet referenced by iov
+    } Output;
+
+    /**
+     * Process a request with the given output destination (see public process functions)
+     */
+    int process(uint8_t *request, size_t req_len, uint8_t *response, size_t resp_size,
+        Output &out);
+
+    /**
+     * Generate a text mode publication message with the given output destination
+     */
+    int txt_pub(Output &out, char *buf, size_t size, const uint16_t pub_ch);
+
+    /**
+     * Generate a binary mode publication message with the given output destination
+     */
+    int bin_pub(Output &out, uint8_t *buf, size_t size, const uint16_t pub_ch);
+
+    /**
+     * Send the data assembled in a buffer to the stream sink to make room for more data
+     *
+     * @param out Output destination
+     * @param buf Buffer containing the data
+     * @param len Length of the data, set to 0 if it was sent
+     *
+     * @returns True if the data was sent, false if not in streaming mode or if the sink failed
+     */
+    bool stream_flush(Output &out, uint8_t *buf, size_t &len);
+
+    /**
+     * Append a fragment to the list of the scatter-gather response
+     *
+     * The fragment is merged with the previous one if they are contiguous in memory.
+     *
+     * @returns False if the maximum number of fragments is reached
+     */
+    bool iov_add(Output &out, const void *base, size_t len);
+
+    /**
+     * Write a node name in quotes followed by a separator in scatter-gather mode
+     *
+     * The scratch data up to (including) the opening quote and a reference to the node name
+     * are appended to the fragments, the closing quote and the separator are written to the
+     * scratch buffer. Names shorter than TS_IOV_MIN_NAME_LEN or containing characters which
+     * have to be escaped are copied to the scratch buffer instead.
+     *
+     * @param out Output destination in scatter-gather mode
+     * @param buf Current position in the scratch buffer
+     * @param size Remaining space in the scratch buffer
+     * @param node Node whose name should be written
+     * @param separator Character after the closing quote
+     *
+     * @returns Number of bytes written to the scratch buffer or 0 in case of error
+     */
+    int iov_add_name(Output &out, char *buf, size_t size, const DataNode *node, char separator);
+
     /**
      * Fill the resp buffer with a JSON response status message
      *
@@ -558,9 +1336,79 @@ private:
      */
     int bin_response(uint8_t code);
 
+    /**
+     * Parts of a data node serialized as one item of a response or publication message
+     */
+    enum NodeItem {
+        NODE_VALUE,         ///< Value only (array element or single value)
+        NODE_NAME,          ///< Name only (array element)
+        NODE_NAME_VALUE,    ///< Name and value (map element)
+        NODE_ID,            ///< ID only (array element, binary mode)
+        NODE_ID_VALUE,      ///< ID and value (map element, binary mode)
+    };
+
+    /**
+     * Serialize a data node item in JSON format including the trailing comma
+     *
+     * In scatter-gather mode, node names are referenced instead of copied to the buffer. If buf
+     * is NULL, only the length is calculated (same as the json_serialize_* functions).
+     *
+     * @param out Output destination of the message
+     * @param buf Pointer to the buffer where the JSON data should be stored
+     * @param size Size of the buffer
+     * @param node Pointer to node which should be serialized
+     * @param item Parts of the node to be serialized (NODE_VALUE, NODE_NAME or NODE_NAME_VALUE)
+     *
+     * @returns Length of data written to buffer or 0 in case of error
+     */
+    int json_serialize_node(Output &out, char *buf, size_t size, const DataNode *node,
+        NodeItem item);
+
+    /**
+     * Append a data node item in JSON format to a response or publication message
+     *
+     * In streaming mode, the buffer is flushed if the item does not fit anymore. In measure
+     * mode, only the length of the item is counted.
+     *
+     * @param out Output destination of the message
+     * @param buf Pointer to the message buffer
+     * @param size Size of the message buffer
+     * @param len Current length of the message in the buffer, updated by this function
+     * @param node Pointer to node which should be serialized
+     * @param item Parts of the node to be serialized
+     *
+     * @returns True for success, false if the item could not be serialized
+     */
+    bool json_append_node(Output &out, char *buf, size_t size, size_t &len,
+        const DataNode *node, NodeItem item);
+
+    /**
+     * Serialize a data node item in CBOR format
+     *
+     * If buf is NULL, only the length is calculated (same as the cbor_serialize_* functions).
+     *
+     * @param buf Pointer to the buffer where the CBOR data should be stored
+     * @param size Size of the buffer
+     * @param node Pointer to node which should be serialized
+     * @param item Parts of the node to be serialized
+     *
+     * @returns Length of data written to buffer or 0 in case of error
+     */
+    int cbor_serialize_node(uint8_t *buf, size_t size, const DataNode *node, NodeItem item);
+
+    /**
+     * Append a data node item in CBOR format to a response or publication message
+     *
+     * Same as json_append_node for binary mode.
+     */
+    bool cbor_append_node(Output &out, uint8_t *buf, size_t size, size_t &len,
+        const DataNode *node, NodeItem item);
+
     /**
      * Serialize a node value into a JSON string
      *
+     * If buf is NULL, only the length is calculated and size is ignored.
+     *
      * @param buf Pointer to the buffer where the JSON value should be stored
      * @param size Size of the buffer, i.e. maximum allowed length of the value
      * @param node Pointer to node which should be serialized
@@ -574,7 +1422,7 @@ private:
      *
      * same as json_serialize_value, just that the node name is also serialized
      */
-    int json_serialize_name_value(char *buf, size_t size, const DataNode *node);
+    int json_serialize_name_value(Output &out, char *buf, size_t size, const DataNode *node);
 
     /**
      * Deserialize a node value from a JSON string
@@ -588,6 +1436,16 @@ private:
      */
     int json_deserialize_value(char *buf, size_t len, jsmntype_t type, const DataNode *node);
 
+    /**
+     * Result of the checks performed during initialization (ThingSet status code)
+     */
+    int init_status = TS_STATUS_VALID;
+
+    /**
+     * Duplicate node ID found during initialization
+     */
+    node_id_t conflicting_id = 0;
+
     /**
      * Array of nodes database provided during initialization
      */
@@ -598,6 +1456,118 @@ private:
      */
     size_t num_nodes;
 
+    /**
+     * Node IDs sorted in ascending order (NULL if not available)
+     */
+    const TsIdIndexEntry *id_index = NULL;
+
+#if TS_NODE_ID_HASH_TABLE
+    /**
+     * Hash table (open addressing with linear probing) containing IDs and positions of all
+     * nodes, NULL if not available
+     *
+     * The table size is a power of two with at least twice the number of nodes. Empty slots
+     * are marked with ID 0.
+     */
+    TsIdIndexEntry *id_hash = NULL;
+
+    /**
+     * Right shift applied to the multiplicative hash of an ID to get the slot in id_hash
+     */
+    uint8_t id_hash_shift = 0;
+#endif
+
+    /**
+     * Positions of all nodes in data_nodes grouped by the parent node, keeping the order of the
+     * data_nodes array within each group (NULL if not available)
+     */
+    const node_pos_t *children = NULL;
+
+    /**
+     * Start of the children of each parent in the children table (num_nodes + 3 elements)
+     *
+     * The children of the node at position i in data_nodes are stored in children between
+     * child_start[i] and child_start[i + 1]. See child_slot() for root and orphaned nodes.
+     */
+    const node_pos_t *child_start = NULL;
+
+    /**
+     * Length and hash of the name of each node in data_nodes (same order as data_nodes)
+     */
+    const TsNameInfo *name_info = NULL;
+
+    /**
+     * True if above lookup tables were allocated by the constructor
+     */
+    bool index_allocated = false;
+
+    /**
+     * True if the length of an array was detected because of TS_AUTODETECT_ARRLEN
+     */
+    bool arrlen_autodetected = false;
+
+    /**
+     * Nodes published in each channel as one bit set per bit of the pubsub flags (bit n of a set
+     * belongs to data_nodes[n]), or NULL if not available
+     */
+    uint32_t *pub_bits = NULL;
+
+    /**
+     * Number of 32-bit words of each set in pub_bits
+     */
+    size_t pub_words = 0;
+
+    /**
+     * Number of nodes in each set of pub_bits
+     */
+    size_t pub_count[16] = {};
+
+    /**
+     * State of a publication channel in delta mode
+     */
+    typedef struct {
+        uint32_t *snapshots;        ///< Value snapshot of each node at the last publication
+        uint32_t *positions;        ///< Position in data_nodes of the node of each snapshot
+        uint8_t *selected;          ///< Bit set of the nodes selected for the current message
+        size_t num_nodes;           ///< Number of nodes in above arrays
+        uint16_t refresh_interval;  ///< Publish all nodes in every n-th interval (0 for never)
+        uint16_t cycle;             ///< Number of intervals since all nodes were published
+        bool full;                  ///< True if all nodes have to be published in next message
+    } PubDelta;
+
+    /**
+     * Delta publication state of each channel (NULL if delta mode is not enabled)
+     */
+    PubDelta *pub_delta[16] = {};
+
+    /**
+     * Publication message template of each channel (NULL if not enabled)
+     */
+    PubTemplate *pub_template[16] = {};
+
+#if TS_PATH_CACHE_SIZE > 0
+    /**
+     * Cache entry for a resolved path
+     */
+    typedef struct {
+        DataNode *node;         ///< Endpoint of the path (NULL if entry is not used)
+        uint32_t hash;          ///< Hash of the path
+        uint16_t len;           ///< Length of the path
+        uint16_t last_used;     ///< Value of path_cache_clock at last access
+    } PathCacheEntry;
+
+    /**
+     * Recently used paths for get_endpoint (shared by all threads calling get_endpoint, see
+     * there)
+     */
+    PathCacheEntry path_cache[TS_PATH_CACHE_SIZE] = {};
+
+    /**
+     * Counter incremented at each path cache access to determine the least recently used entry
+     */
+    uint16_t path_cache_clock = 0;
+#endif
+
     /**
      * Pointer to request buffer (provided in process function)
      */
@@ -618,21 +1588,57 @@ private:
      */
     size_t resp_size;
 
+    /**
+     * Output destination of the response (provided in process function)
+     */
+    Output *resp_out = NULL;
+
     /**
      * Pointer to the start of JSON payload in the request
      */
     char *json_str;
 
+#if TS_NUM_JSON_TOKENS > 0
+    /**
+     * Internal storage for JSON tokens (used unless set_json_tokens was called)
+     */
+    jsmntok_t tokens_buf[TS_NUM_JSON_TOKENS];
+
     /**
      * JSON tokes in json_str parsed by JSMN
      */
-    jsmntok_t tokens[TS_NUM_JSON_TOKENS];
+    jsmntok_t *tokens = tokens_buf;
+#else
+    jsmntok_t *tokens = NULL;
+#endif
+
+    /**
+     * Number of elements available in tokens
+     */
+    size_t num_tokens = TS_NUM_JSON_TOKENS;
 
     /**
      * Number of JSON tokens parsed by JSMN
      */
     int tok_count;
 
+    /**
+     * State of a text mode request received in pieces (see feed)
+     */
+    typedef struct {
+        uint8_t *buf;               ///< Buffer for the request
+        size_t size;                ///< Size of the buffer
+        size_t len;                 ///< Number of bytes received so far (without newline)
+        int path_len;               ///< Length of the path (-1 if not yet received completely)
+        const DataNode *endpoint;   ///< Endpoint of the path (NULL if not found)
+        jsmn_parser parser;         ///< State of the parser for the payload received so far
+        int tok_count;              ///< Result of the last parser run
+        bool tokens_valid;          ///< False if tokens were overwritten by another request
+        bool overflow;              ///< True if the request did not fit into the buffer
+    } FeedState;
+
+    FeedState feed_state = {};
+
     /**
      * Stores current authentication status (authentication as "normal" user as default)
      */
@@ -17,6 +17,15 @@
 int cbor_deserialize_array_type(uint8_t *buf, const DataNode *data_node);
 int cbor_serialize_array_type(uint8_t *buf, size_t size, const DataNode *data_node);
 
+static int cbor_deserialize_node_id(uint8_t *buf, node_id_t *id)
+{
+#if TS_32BIT_NODE_IDS
+    return cbor_deserialize_uint32(buf, id);
+#else
+    return cbor_deserialize_uint16(buf, id);
+#endif
+}
+
 static int cbor_deserialize_data_node(uint8_t *buf, const DataNode *data_node)
 {
     switch (data_node->type) {
@@ -152,54 +161,137 @@ int cbor_serialize_array_type(uint8_t *buf, size_t size, const DataNode *data_no
         return 0;
     }
 
+    // bulk serialization of the most common types
+    switch (array_info->type) {
+    case TS_T_UINT32:
+        return cbor_serialize_array_uint32(buf, (uint32_t *)array_info->ptr,
+            array_info->num_elements, size);
+    case TS_T_INT32:
+        return cbor_serialize_array_int32(buf, (int32_t *)array_info->ptr,
+            array_info->num_elements, size);
+    case TS_T_UINT16:
+        return cbor_serialize_array_uint16(buf, (uint16_t *)array_info->ptr,
+            array_info->num_elements, size);
+    case TS_T_INT16:
+        return cbor_serialize_array_int16(buf, (int16_t *)array_info->ptr,
+            array_info->num_elements, size);
+    case TS_T_FLOAT32:
+        if (data_node->detail != 0) {
+            return cbor_serialize_array_float(buf, (float *)array_info->ptr,
+                array_info->num_elements, size);
+        }
+        break;  // rounded to integers below
+    default:
+        break;
+    }
+
     // Add the length field to the beginning of the CBOR buffer and update the CBOR buffer index
     pos = cbor_serialize_array(buf, array_info->num_elements, size);
+    if (pos == 0) {
+        return 0;
+    }
 
     for (int i = 0; i < array_info->num_elements; i++) {
+        // only measure the length if buf is NULL
+        uint8_t *elem = (buf == NULL) ? NULL : &buf[pos];
+        int len = 0;
         switch (array_info->type) {
 #ifdef TS_64BIT_TYPES_SUPPORT
         case TS_T_UINT64:
-            pos += cbor_serialize_uint(&(buf[pos]), ((uint64_t *)array_info->ptr)[i], size);
+            len = cbor_serialize_uint(elem, ((uint64_t *)array_info->ptr)[i], size - pos);
             break;
         case TS_T_INT64:
-            pos += cbor_serialize_int(&(buf[pos]), ((int64_t *)array_info->ptr)[i], size);
+            len = cbor_serialize_int(elem, ((int64_t *)array_info->ptr)[i], size - pos);
             break;
 #endif
         case TS_T_UINT32:
-            pos += cbor_serialize_uint(&(buf[pos]), ((uint32_t *)array_info->ptr)[i], size);
+            len = cbor_serialize_uint(elem, ((uint32_t *)array_info->ptr)[i], size - pos);
             break;
         case TS_T_INT32:
-            pos += cbor_serialize_int(&(buf[pos]), ((int32_t *)array_info->ptr)[i], size);
+            len = cbor_serialize_int(elem, ((int32_t *)array_info->ptr)[i], size - pos);
             break;
         case TS_T_UINT16:
-            pos += cbor_serialize_uint(&(buf[pos]), ((uint16_t *)array_info->ptr)[i], size);
+            len = cbor_serialize_uint(elem, ((uint16_t *)array_info->ptr)[i], size - pos);
             break;
         case TS_T_INT16:
-            pos += cbor_serialize_int(&(buf[pos]), ((int16_t *)array_info->ptr)[i], size);
+            len = cbor_serialize_int(elem, ((int16_t *)array_info->ptr)[i], size - pos);
             break;
         case TS_T_FLOAT32:
             if (data_node->detail == 0) { // round to 0 digits: use int
 #ifdef TS_64BIT_TYPES_SUPPORT
-                pos += cbor_serialize_int(&(buf[pos]),
-                    llroundf(((float *)array_info->ptr)[i]), size);
+                len = cbor_serialize_int(elem, llroundf(((float *)array_info->ptr)[i]),
+                    size - pos);
 #else
-                pos += cbor_serialize_int(&(buf[pos]),
-                    lroundf(((float *)array_info->ptr)[i]), size);
+                len = cbor_serialize_int(elem, lroundf(((float *)array_info->ptr)[i]),
+                    size - pos);
 #endif
             }
             else {
-                pos += cbor_serialize_float(&(buf[pos]), ((float *)array_info->ptr)[i], size);
+                len = cbor_serialize_float(elem, ((float *)array_info->ptr)[i], size - pos);
             }
             break;
         default:
-            break;
+            continue;
+        }
+        if (len == 0) {
+            return 0;
         }
+        pos += len;
     }
     return pos;
 }
 
+int ThingSet::cbor_serialize_node(uint8_t *buf, size_t size, const DataNode *node,
+    NodeItem item)
+{
+    int key_len = 0;
+    if (item == NODE_ID || item == NODE_ID_VALUE) {
+        key_len = cbor_serialize_uint(buf, node->id, size);
+    }
+    else if (item == NODE_NAME || item == NODE_NAME_VALUE) {
+        key_len = cbor_serialize_string_len(buf, node->name, name_len(node), size);
+    }
+
+    if (item == NODE_ID || item == NODE_NAME) {
+        return key_len;
+    }
+    else if (key_len == 0 && item != NODE_VALUE) {
+        return 0;
+    }
+
+    // only measure the length if buf is NULL
+    int value_len = cbor_serialize_data_node((buf == NULL) ? NULL : &buf[key_len],
+        size - key_len, node);
+    return (value_len > 0) ? key_len + value_len : 0;
+}
+
+bool ThingSet::cbor_append_node(Output &out, uint8_t *buf, size_t size, size_t &len,
+    const DataNode *node, NodeItem item)
+{
+    if (out.measure) {
+        int num_bytes = cbor_serialize_node(NULL, 0, node, item);
+        out.sent += num_bytes;
+        return num_bytes > 0;
+    }
+
+    int num_bytes = cbor_serialize_node(&buf[len], size - len, node, item);
+    if (num_bytes == 0 && stream_flush(out, buf, len)) {
+        num_bytes = cbor_serialize_node(buf, size, node, item);
+    }
+    len += num_bytes;
+    return num_bytes > 0;
+}
+
 int ThingSet::bin_response(uint8_t code)
 {
+    if (resp_out->measure) {
+        // discard length of the content already measured
+        resp_out->sent = 0;
+    }
+    else if (resp_out->sent > 0) {
+        // status of a partly streamed response can't be changed anymore
+        return 0;
+    }
     if (resp_size > 0) {
         resp[0] = code;
         return 1;
@@ -222,7 +314,7 @@ int ThingSet::bin_process()
     }
     else if ((req[pos] & CBOR_TYPE_MASK) == CBOR_UINT) {
         node_id_t id = 0;
-        pos += cbor_deserialize_uint16(&req[pos], &id);
+        pos += cbor_deserialize_node_id(&req[pos], &id);
         endpoint = get_node(id);
     }
     else if (req[pos] == CBOR_UNDEFINED) {
@@ -263,7 +355,7 @@ int ThingSet::bin_fetch(const DataNode *parent, unsigned int pos_payload)
      */
 
     unsigned int pos_req = pos_payload;
-    unsigned int pos_resp = 0;
+    size_t pos_resp = 0;
     uint16_t num_elements, element = 0;
 
     pos_resp += bin_response(TS_STATUS_CONTENT);   // init response buffer
@@ -286,7 +378,7 @@ int ThingSet::bin_fetch(const DataNode *parent, unsigned int pos_payload)
         size_t num_bytes = 0;       // temporary storage of cbor data length (req and resp)
 
         node_id_t id;
-        num_bytes = cbor_deserialize_uint16(&req[pos_req], &id);
+        num_bytes = cbor_deserialize_node_id(&req[pos_req], &id);
         if (num_bytes == 0) {
             return bin_response(TS_STATUS_BAD_REQUEST);
         }
@@ -300,11 +392,9 @@ int ThingSet::bin_fetch(const DataNode *parent, unsigned int pos_payload)
             return bin_response(TS_STATUS_UNAUTHORIZED);
         }
 
-        num_bytes = cbor_serialize_data_node(&resp[pos_resp], resp_size - pos_resp, data_node);
-        if (num_bytes == 0) {
+        if (!cbor_append_node(*resp_out, resp, resp_size, pos_resp, data_node, NODE_VALUE)) {
             return bin_response(TS_STATUS_RESPONSE_TOO_LARGE);
         }
-        pos_resp += num_bytes;
         element++;
     }
 
@@ -319,12 +409,15 @@ int ThingSet::bin_fetch(const DataNode *parent, unsigned int pos_payload)
 int ThingSet::bin_sub(uint8_t *cbor_data, size_t len, uint16_t auth_flags, uint16_t sub_ch)
 {
     uint8_t resp_tmp[1] = {};   // only one character as response expected
+    Output out = {};
     req = cbor_data;
     req_len = len;
     resp = resp_tmp;
     resp_size = sizeof(resp_tmp);
+    resp_out = &out;
     bin_patch(NULL, 1, auth_flags, sub_ch);
-    return resp[0];
+    resp_out = NULL;
+    return resp_tmp[0];
 }
 
 int ThingSet::bin_patch(const DataNode *parent, unsigned int pos_payload, uint16_t auth_flags,
@@ -347,7 +440,7 @@ int ThingSet::bin_patch(const DataNode *parent, unsigned int pos_payload, uint16
         size_t num_bytes = 0;       // temporary storage of cbor data length (req and resp)
 
         node_id_t id;
-        num_bytes = cbor_deserialize_uint16(&req[pos_req], &id);
+        num_bytes = cbor_deserialize_node_id(&req[pos_req], &id);
         if (num_bytes == 0) {
             return bin_response(TS_STATUS_BAD_REQUEST);
         }
@@ -421,20 +514,19 @@ int ThingSet::bin_exec(const DataNode *node, unsigned int pos_payload)
         return bin_response(TS_STATUS_FORBIDDEN);
     }
 
-    for (unsigned int i = 0; i < num_nodes; i++) {
-        if (data_nodes[i].parent == node->id) {
-            if (element >= num_elements) {
-                // more child nodes found than parameters were passed
-                return bin_response(TS_STATUS_BAD_REQUEST);
-            }
-            int num_bytes = cbor_deserialize_data_node(&req[pos_req], &data_nodes[i]);
-            if (num_bytes == 0) {
-                // deserializing the value was not successful
-                return bin_response(TS_STATUS_UNSUPPORTED_FORMAT);
-            }
-            pos_req += num_bytes;
-            element++;
+    ChildIterator it;
+    for (DataNode *child = first_child(it, node->id); child != NULL; child = next_child(it)) {
+        if (element >= num_elements) {
+            // more child nodes found than parameters were passed
+            return bin_response(TS_STATUS_BAD_REQUEST);
         }
+        int num_bytes = cbor_deserialize_data_node(&req[pos_req], child);
+        if (num_bytes == 0) {
+            // deserializing the value was not successful
+            return bin_response(TS_STATUS_UNSUPPORTED_FORMAT);
+        }
+        pos_req += num_bytes;
+        element++;
     }
 
     if (num_elements > element) {
@@ -451,54 +543,96 @@ int ThingSet::bin_exec(const DataNode *node, unsigned int pos_payload)
 
 int ThingSet::bin_pub(uint8_t *buf, size_t buf_size, const uint16_t pub_ch)
 {
-    buf[0] = TS_PUBMSG;
-    int len = 1;
+    Output out = {};
+    return bin_pub(out, buf, buf_size, pub_ch);
+}
 
-    // find out number of elements to be published
-    int num_ids = 0;
-    for (unsigned int i = 0; i < num_nodes; i++) {
-        if (data_nodes[i].pubsub & pub_ch) {
-            num_ids++;
-        }
+int ThingSet::bin_pub(Output &out, uint8_t *buf, size_t buf_size, const uint16_t pub_ch)
+{
+    size_t num_ids = 0;
+    const uint8_t *selected = select_pub_delta(pub_ch, num_ids, !out.measure);
+    if (selected == NULL) {
+        num_ids = num_pub_nodes(pub_ch);
+    }
+    else if (num_ids == 0) {
+        return 0;   // no changes in delta mode
     }
 
-    len += cbor_serialize_map(&buf[len], num_ids, buf_size - len);
+    buf[0] = TS_PUBMSG;
+    size_t len = 1;
 
-    for (unsigned int i = 0; i < num_nodes; i++) {
-        if (data_nodes[i].pubsub & pub_ch) {
-            len += cbor_serialize_uint(&buf[len], data_nodes[i].id, buf_size - len);
-            size_t num_bytes = cbor_serialize_data_node(&buf[len], buf_size - len, &data_nodes[i]);
-            if (num_bytes == 0) {
-                return 0;
-            }
-            else {
-                len += num_bytes;
-            }
+    int len_header = cbor_serialize_map(&buf[len], num_ids, buf_size - len);
+    if (len_header == 0) {
+        request_full_pub(pub_ch);
+        return 0;
+    }
+    len += len_header;
+
+    PubIterator it;
+    size_t i = 0;
+    for (DataNode *node = first_pub_node(it, pub_ch); node != NULL;
+            node = next_pub_node(it), i++) {
+        if (!pub_delta_selected(selected, i)) {
+            continue;
+        }
+        if (!cbor_append_node(out, buf, buf_size, len, node, NODE_ID_VALUE)) {
+            request_full_pub(pub_ch);
+            return 0;
         }
     }
     return len;
 }
 
+int ThingSet::bin_pub_size(const uint16_t pub_ch)
+{
+    uint8_t buf[6];     // only used for the message header
+    Output out = {};
+    out.measure = true;
+
+    size_t len = bin_pub(out, buf, sizeof(buf), pub_ch);
+    return (len > 0) ? out.sent + len : 0;
+}
+
+int ThingSet::bin_pub(uint8_t *buf, size_t buf_size, const uint16_t pub_ch, TsStreamSink sink,
+    void *ctx)
+{
+    Output out = {};
+    out.sink = sink;
+    out.ctx = ctx;
+
+    size_t len = bin_pub(out, buf, buf_size, pub_ch);
+    int total = (len > 0 && stream_flush(out, buf, len)) ? out.sent : 0;
+    if (len > 0 && total == 0) {
+        request_full_pub(pub_ch);   // last chunk could not be sent
+    }
+    return total;
+}
+
 int ThingSet::bin_pub_can(int &start_pos, uint16_t pub_ch, uint8_t can_dev_id,
     uint32_t &msg_id, uint8_t (&msg_data)[8])
 {
     int msg_len = -1;
 
-    for (unsigned int i = start_pos; i < num_nodes; i++) {
-        if (data_nodes[i].pubsub & pub_ch) {
-            msg_id = TS_CAN_BASE_PUBSUB | TS_CAN_PRIO_PUBSUB_LOW
-                | TS_CAN_DATA_ID_SET(data_nodes[i].id)
-                | TS_CAN_SOURCE_SET(can_dev_id);
+    PubIterator it;
+    for (DataNode *node = first_pub_node(it, pub_ch, start_pos); node != NULL;
+            node = next_pub_node(it)) {
+#if TS_32BIT_NODE_IDS
+        if (node->id > 0xFFFF) {
+            continue;   // does not fit into data ID field of CAN ID
+        }
+#endif
+        msg_id = TS_CAN_BASE_PUBSUB | TS_CAN_PRIO_PUBSUB_LOW
+            | TS_CAN_DATA_ID_SET(node->id)
+            | TS_CAN_SOURCE_SET(can_dev_id);
 
-            msg_len = cbor_serialize_data_node(msg_data, 8, &data_nodes[i]);
+        msg_len = cbor_serialize_data_node(msg_data, 8, node);
 
-            if (msg_len > 0) {
-                // node found and successfully encoded, increase start pos for next run
-                start_pos = i + 1;
-                break;
-            }
-            // else: data too long, take next node
+        if (msg_len > 0) {
+            // node found and successfully encoded, increase start pos for next run
+            start_pos = node - data_nodes + 1;
+            break;
         }
+        // else: data too long, take next node
     }
 
     if (msg_len <= 0) {
@@ -543,49 +677,60 @@ int ThingSet::name_cbor(void)
 
 int ThingSet::bin_get(const DataNode *parent, bool values, bool ids_only)
 {
-    unsigned int len = 0;       // current length of response
+    size_t len = 0;       // current length of response
     len += bin_response(TS_STATUS_CONTENT);   // init response buffer
 
-    // find out number of elements
-    int num_elements = 0;
-    for (unsigned int i = 0; i < num_nodes; i++) {
-        if (data_nodes[i].access & TS_READ_MASK
-            && (data_nodes[i].parent == parent->id))
-        {
-            num_elements++;
+    // number of child nodes is known from the index, non-readable nodes are corrected below
+    size_t num_elements = num_children(parent->id);
+    ChildIterator it;
+    if (resp_out->sink != NULL) {
+        // header must be final before any data is streamed
+        num_elements = 0;
+        for (DataNode *node = first_child(it, parent->id); node != NULL; node = next_child(it)) {
+            if (node->access & TS_READ_MASK) {
+                num_elements++;
+            }
         }
     }
+    size_t pos_header = len;
+    int len_header;
 
     if (values && !ids_only) {
-        len += cbor_serialize_map(&resp[len], num_elements, resp_size - len);
+        len_header = cbor_serialize_map(&resp[len], num_elements, resp_size - len);
     }
     else {
-        len += cbor_serialize_array(&resp[len], num_elements, resp_size - len);
+        len_header = cbor_serialize_array(&resp[len], num_elements, resp_size - len);
     }
+    if (len_header == 0) {
+        return bin_response(TS_STATUS_RESPONSE_TOO_LARGE);
+    }
+    len += len_header;
 
-    for (unsigned int i = 0; i < num_nodes; i++) {
-        if (data_nodes[i].access & TS_READ_MASK
-            && (data_nodes[i].parent == parent->id))
-        {
-            int num_bytes = 0;
-            if (ids_only) {
-                num_bytes = cbor_serialize_uint(&resp[len], data_nodes[i].id, resp_size - len);
-            }
-            else {
-                num_bytes = cbor_serialize_string(&resp[len], data_nodes[i].name,
-                    resp_size - len);
-                if (values) {
-                    num_bytes += cbor_serialize_data_node(&resp[len + num_bytes],
-                        resp_size - len - num_bytes, &data_nodes[i]);
-                }
-            }
-
-            if (num_bytes == 0) {
+    NodeItem item = ids_only ? NODE_ID : (values ? NODE_NAME_VALUE : NODE_NAME);
+    size_t num_readable = 0;
+    for (DataNode *node = first_child(it, parent->id); node != NULL; node = next_child(it)) {
+        if (node->access & TS_READ_MASK) {
+            if (!cbor_append_node(*resp_out, resp, resp_size, len, node, item)) {
                 return bin_response(TS_STATUS_RESPONSE_TOO_LARGE);
-            } else {
-                len += num_bytes;
             }
+            num_readable++;
+        }
+    }
+
+    if (num_readable != num_elements) {
+        // rewrite header with actual number of elements (can only get shorter)
+        uint8_t header[5];
+        int len_new_header;
+        if (values && !ids_only) {
+            len_new_header = cbor_serialize_map(header, num_readable, sizeof(header));
+        }
+        else {
+            len_new_header = cbor_serialize_array(header, num_readable, sizeof(header));
         }
+        memmove(&resp[pos_header + len_new_header], &resp[pos_header + len_header],
+            len - pos_header - len_header);
+        memcpy(&resp[pos_header], header, len_new_header);
+        len -= len_header - len_new_header;
     }
 
     return len;
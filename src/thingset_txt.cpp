@@ -7,19 +7,144 @@
 #include "ts_config.h"
 #include "thingset.h"
 #include "jsmn.h"
+#include "json.h"
 
-#include <math.h>
 #include <stdbool.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <errno.h>
-#include <cinttypes>
 
 
+/*
+ * Appends a comma to a value serialized by one of the json_serialize_* functions
+ *
+ * Returns length of the value including the comma or 0 if the buffer is too small
+ */
+static int _json_add_comma(char *buf, size_t size, int len)
+{
+    if (len == 0 || (size_t)len + 2 > size) {
+        return 0;
+    }
+    if (buf != NULL) {
+        buf[len] = ',';
+        buf[len + 1] = '\0';
+    }
+    return len + 1;
+}
+
+/*
+ * Writes a constant string including null termination
+ *
+ * Returns length of the string or 0 if the buffer is too small (only the length if buf is NULL)
+ */
+static int _json_serialize_literal(char *buf, size_t size, const char *str)
+{
+    size_t len = strlen(str);
+    if (buf != NULL) {
+        if (len + 1 > size) {
+            return 0;
+        }
+        memcpy(buf, str, len + 1);
+    }
+    return len;
+}
+
+/*
+ * Returns a position in the buffer or NULL if only the length is calculated
+ */
+static inline char *_json_pos(char *buf, size_t pos)
+{
+    return (buf == NULL) ? NULL : &buf[pos];
+}
+
+/*
+ * Returns the number of decimal digits used to serialize a float node (negative for the shortest
+ * representation)
+ */
+static int _float_digits(const DataNode *node)
+{
+#if TS_JSON_SHORTEST_FLOATS
+    return JSON_FLOAT_SHORTEST;
+#else
+    return node->detail;
+#endif
+}
+
+/*
+ * Serializes arrays of numeric types supported by the bulk functions of the JSON library
+ *
+ * Returns length of the array, 0 if the buffer is too small or -1 if the type is not supported
+ */
+static int _json_serialize_array(char *buf, size_t size, const ArrayInfo *array_info,
+    int digits)
+{
+    switch (array_info->type) {
+    case TS_T_UINT32:
+        return json_serialize_array_uint32(buf, (uint32_t *)array_info->ptr,
+            array_info->num_elements, size);
+    case TS_T_INT32:
+        return json_serialize_array_int32(buf, (int32_t *)array_info->ptr,
+            array_info->num_elements, size);
+    case TS_T_UINT16:
+        return json_serialize_array_uint16(buf, (uint16_t *)array_info->ptr,
+            array_info->num_elements, size);
+    case TS_T_INT16:
+        return json_serialize_array_int16(buf, (int16_t *)array_info->ptr,
+            array_info->num_elements, size);
+    case TS_T_FLOAT32:
+        return json_serialize_array_float(buf, (float *)array_info->ptr,
+            array_info->num_elements, digits, size);
+    default:
+        return -1;
+    }
+}
+
+/*
+ * Writes a node name in quotes followed by a separator, e.g. "name": or "name",
+ *
+ * Returns number of characters (without null termination) or 0 if the buffer is too small
+ */
+static int _json_serialize_name(char *buf, size_t size, const char *name, size_t len,
+    char separator)
+{
+    if (len + 4 > size) {
+        return 0;
+    }
+    int pos = json_serialize_string(buf, name, len, size - 1);
+    if (pos == 0) {
+        return 0;
+    }
+    if (buf != NULL) {
+        buf[pos] = separator;
+        buf[pos + 1] = '\0';
+    }
+    return pos + 1;
+}
+
+/*
+ * Returns the length of a node name in quotes (including escape sequences) and a separator
+ */
+static size_t _json_name_len(const char *name, size_t len)
+{
+    return _json_serialize_name(NULL, SIZE_MAX, name, len, ',');
+}
+
 int ThingSet::txt_response(int code)
 {
     size_t pos = 0;
+    if (resp_out->measure) {
+        // discard length of the content already measured
+        resp_out->sent = 0;
+    }
+    else if (resp_out->sent > 0) {
+        // status of a partly streamed response can't be changed anymore
+        return 0;
+    }
+    if (resp_out->iov != NULL) {
+        // discard fragments of the content already generated
+        resp_out->iov_count = 0;
+        resp_out->iov_mark = (const char *)resp;
+    }
 #ifdef TS_VERBOSE_STATUS_MESSAGES
     switch(code) {
         // success
@@ -94,109 +219,151 @@ int ThingSet::json_serialize_value(char *buf, size_t size, const DataNode *node)
 {
     size_t pos = 0;
     const DataNode *sub_node;
-    float value;
+
+    if (buf == NULL) {
+        size = SIZE_MAX;    // only calculate the length
+    }
 
     switch (node->type) {
 #ifdef TS_64BIT_TYPES_SUPPORT
     case TS_T_UINT64:
-        pos = snprintf(&buf[pos], size - pos, "%" PRIu64 ",", *((uint64_t *)node->data));
+        pos = _json_add_comma(buf, size,
+            json_serialize_uint64(buf, *((uint64_t *)node->data), size));
         break;
     case TS_T_INT64:
-        pos = snprintf(&buf[pos], size - pos, "%" PRIi64 ",", *((int64_t *)node->data));
+        pos = _json_add_comma(buf, size,
+            json_serialize_int64(buf, *((int64_t *)node->data), size));
         break;
 #endif
     case TS_T_UINT32:
-        pos = snprintf(&buf[pos], size - pos, "%" PRIu32 ",", *((uint32_t *)node->data));
+        pos = _json_add_comma(buf, size,
+            json_serialize_uint32(buf, *((uint32_t *)node->data), size));
         break;
     case TS_T_INT32:
-        pos = snprintf(&buf[pos], size - pos, "%" PRIi32 ",", *((int32_t *)node->data));
+        pos = _json_add_comma(buf, size,
+            json_serialize_int32(buf, *((int32_t *)node->data), size));
         break;
     case TS_T_UINT16:
-        pos = snprintf(&buf[pos], size - pos, "%" PRIu16 ",", *((uint16_t *)node->data));
+        pos = _json_add_comma(buf, size,
+            json_serialize_uint32(buf, *((uint16_t *)node->data), size));
         break;
     case TS_T_INT16:
-        pos = snprintf(&buf[pos], size - pos, "%" PRIi16 ",", *((int16_t *)node->data));
+        pos = _json_add_comma(buf, size,
+            json_serialize_int32(buf, *((int16_t *)node->data), size));
         break;
     case TS_T_FLOAT32:
-        value = *((float *)node->data);
-        if (isnan(value) || isinf(value)) {
-            /* JSON spec does not support NaN and Inf, so we need to use null instead */
-            return snprintf(buf, size, "null,");
-        }
-        else {
-            pos = snprintf(&buf[pos], size - pos, "%.*f,", node->detail, value);
-        }
+        // NaN and Inf are serialized as null, as they are not supported by JSON
+        pos = _json_add_comma(buf, size,
+            json_serialize_float(buf, *((float *)node->data), _float_digits(node), size));
         break;
     case TS_T_BOOL:
-        pos = snprintf(&buf[pos], size - pos, "%s,",
-                (*((bool *)node->data) == true ? "true" : "false"));
+        pos = _json_serialize_literal(buf, size,
+            (*((bool *)node->data) == true) ? "true," : "false,");
         break;
     case TS_T_EXEC:
-        pos = snprintf(&buf[pos], size - pos, "null,");
+        pos = _json_serialize_literal(buf, size, "null,");
         break;
     case TS_T_STRING:
-        pos = snprintf(&buf[pos], size - pos, "\"%s\",", (char *)node->data);
+        pos = _json_add_comma(buf, size, json_serialize_string(buf, (char *)node->data,
+            strlen((char *)node->data), size));
         break;
-    case TS_T_PUBSUB:
-        pos = snprintf(&buf[pos], size - pos, "[]") - 1;
-        for (unsigned int i = 0; i < num_nodes; i++) {
-            if (data_nodes[i].pubsub & (uint16_t)node->detail) {
-                pos += snprintf(&buf[pos], size - pos, "\"%s\",", data_nodes[i].name);
+    case TS_T_PUBSUB: {
+        pos = _json_serialize_literal(buf, size, "[");
+        if (pos == 0) {
+            return 0;
+        }
+        bool empty = true;
+        PubIterator it;
+        for (DataNode *pub_node = first_pub_node(it, (uint16_t)node->detail);
+                pub_node != NULL; pub_node = next_pub_node(it)) {
+            int len = _json_serialize_name(_json_pos(buf, pos), size - pos, pub_node->name,
+                name_len(pub_node), ',');
+            if (len == 0) {
+                return 0;
             }
+            pos += len;
+            empty = false;
+        }
+        if (!empty) {
+            pos--; // remove trailing comma
         }
-        pos--; // remove trailing comma
-        pos += snprintf(&buf[pos], size - pos, "],");
+        int len = _json_serialize_literal(_json_pos(buf, pos), size - pos, "],");
+        pos = (len > 0) ? pos + len : 0;
         break;
+    }
     case TS_T_ARRAY:
         ArrayInfo *array_info = (ArrayInfo *)node->data;
         if (!array_info) {
             return 0;
         }
-        pos += snprintf(&buf[pos], size - pos, "[");
+        int bulk_len = _json_serialize_array(buf, size, array_info, _float_digits(node));
+        if (bulk_len >= 0) {
+            pos = _json_add_comma(buf, size, bulk_len);
+            break;
+        }
+        pos = _json_serialize_literal(buf, size, "[");
+        if (pos == 0) {
+            return 0;
+        }
         for (int i = 0; i < array_info->num_elements; i++) {
+            char *elem = _json_pos(buf, pos);
+            int len = 0;
             switch (array_info->type) {
+#ifdef TS_64BIT_TYPES_SUPPORT
             case TS_T_UINT64:
-                pos += snprintf(&buf[pos], size - pos, "%" PRIu64 ",",
-                        ((uint64_t *)array_info->ptr)[i]);
+                len = json_serialize_uint64(elem, ((uint64_t *)array_info->ptr)[i],
+                        size - pos);
                 break;
             case TS_T_INT64:
-                pos += snprintf(&buf[pos], size - pos, "%" PRIi64 ",",
-                        ((int64_t *)array_info->ptr)[i]);
+                len = json_serialize_int64(elem, ((int64_t *)array_info->ptr)[i],
+                        size - pos);
                 break;
+#endif
             case TS_T_UINT32:
-                pos += snprintf(&buf[pos], size - pos, "%" PRIu32 ",",
-                        ((uint32_t *)array_info->ptr)[i]);
+                len = json_serialize_uint32(elem, ((uint32_t *)array_info->ptr)[i],
+                        size - pos);
                 break;
             case TS_T_INT32:
-                pos += snprintf(&buf[pos], size - pos, "%" PRIi32 ",",
-                        ((int32_t *)array_info->ptr)[i]);
+                len = json_serialize_int32(elem, ((int32_t *)array_info->ptr)[i],
+                        size - pos);
                 break;
             case TS_T_UINT16:
-                pos += snprintf(&buf[pos], size - pos, "%" PRIu16 ",",
-                        ((uint16_t *)array_info->ptr)[i]);
+                len = json_serialize_uint32(elem, ((uint16_t *)array_info->ptr)[i],
+                        size - pos);
                 break;
             case TS_T_INT16:
-                pos += snprintf(&buf[pos], size - pos, "%" PRIi16 ",",
-                        ((int16_t *)array_info->ptr)[i]);
+                len = json_serialize_int32(elem, ((int16_t *)array_info->ptr)[i],
+                        size - pos);
                 break;
             case TS_T_FLOAT32:
-                pos += snprintf(&buf[pos], size - pos, "%.*f,", node->detail,
-                        ((float *)array_info->ptr)[i]);
+                len = json_serialize_float(elem, ((float *)array_info->ptr)[i],
+                        _float_digits(node), size - pos);
                 break;
             case TS_T_NODE_ID:
-                sub_node = get_node(((uint16_t *)array_info->ptr)[i]);
+                sub_node = get_node(((node_id_t *)array_info->ptr)[i]);
                 if (sub_node) {
-                    pos += snprintf(&buf[pos], size - pos, "\"%s\",", sub_node->name);
+                    len = _json_serialize_name(elem, size - pos, sub_node->name,
+                        name_len(sub_node), ',');
+                    if (len == 0) {
+                        return 0;
+                    }
+                    pos += len;
                 }
-                break;
+                continue;
             default:
-                break;
+                continue;
+            }
+            len = _json_add_comma(elem, size - pos, len);
+            if (len == 0) {
+                return 0;
             }
+            pos += len;
         }
         if (array_info->num_elements > 0) {
             pos--; // remove trailing comma
         }
-        pos += snprintf(&buf[pos], size - pos, "],");
+        int len = _json_serialize_literal(_json_pos(buf, pos), size - pos, "],");
+        pos = (len > 0) ? pos + len : 0;
         break;
     }
 
@@ -208,11 +375,49 @@ int ThingSet::json_serialize_value(char *buf, size_t size, const DataNode *node)
     }
 }
 
-int ThingSet::json_serialize_name_value(char *buf, size_t size, const DataNode* node)
+int ThingSet::iov_add_name(Output &out, char *buf, size_t size, const DataNode *node,
+    char separator)
+{
+    size_t len = name_len(node);
+    if (len < TS_IOV_MIN_NAME_LEN || json_find_escape(node->name, len) < len) {
+        // an additional fragment would cost more than copying a short name, and names with
+        // special characters need escape sequences
+        return _json_serialize_name(buf, size, node->name, len, separator);
+    }
+    if (size < 4) {
+        return 0;
+    }
+    buf[0] = '"';
+    if (!iov_add(out, out.iov_mark, buf + 1 - out.iov_mark) || !iov_add(out, node->name, len)) {
+        return 0;
+    }
+    out.iov_mark = buf + 1;
+    buf[1] = '"';
+    buf[2] = separator;
+    buf[3] = '\0';
+    return 3;
+}
+
+int ThingSet::json_serialize_name_value(Output &out, char *buf, size_t size,
+    const DataNode* node)
 {
-    size_t pos = snprintf(buf, size, "\"%s\":", node->name);
+    size_t pos;
+    if (buf == NULL) {
+        size = SIZE_MAX;    // only calculate the length
+    }
+
+    if (out.iov != NULL) {
+        // scatter-gather mode: reference the constant name instead of copying it
+        pos = iov_add_name(out, buf, size, node, ':');
+    }
+    else {
+        pos = _json_serialize_name(buf, size, node->name, name_len(node), ':');
+    }
+    if (pos == 0 || pos >= size) {
+        return 0;
+    }
 
-    int len_value = json_serialize_value(&buf[pos], size - pos, node);
+    int len_value = json_serialize_value(_json_pos(buf, pos), size - pos, node);
     pos += len_value;
 
     if (len_value > 0 && pos < size) {
@@ -223,30 +428,70 @@ int ThingSet::json_serialize_name_value(char *buf, size_t size, const DataNode*
     }
 }
 
+int ThingSet::json_serialize_node(Output &out, char *buf, size_t size, const DataNode *node,
+    NodeItem item)
+{
+    if (buf == NULL) {
+        size = SIZE_MAX;    // only calculate the length
+    }
+
+    switch (item) {
+    case NODE_VALUE:
+        return json_serialize_value(buf, size, node);
+    case NODE_NAME_VALUE:
+        return json_serialize_name_value(out, buf, size, node);
+    case NODE_NAME:
+        if (out.iov != NULL) {
+            // scatter-gather mode: reference the constant name instead of copying it
+            return iov_add_name(out, buf, size, node, ',');
+        }
+        return _json_serialize_name(buf, size, node->name, name_len(node), ',');
+    default:
+        return 0;
+    }
+}
+
+bool ThingSet::json_append_node(Output &out, char *buf, size_t size, size_t &len,
+    const DataNode *node, NodeItem item)
+{
+    if (out.measure) {
+        int num_bytes = json_serialize_node(out, NULL, 0, node, item);
+        out.sent += num_bytes;
+        return num_bytes > 0;
+    }
+
+    int num_bytes = json_serialize_node(out, &buf[len], size - len, node, item);
+    if (num_bytes == 0 && stream_flush(out, (uint8_t *)buf, len)) {
+        num_bytes = json_serialize_node(out, buf, size, node, item);
+    }
+    len += num_bytes;
+    return num_bytes > 0;
+}
+
 void ThingSet::dump_json(node_id_t node_id, int level)
 {
     uint8_t buf[100];
     bool first = true;
-    for (unsigned int i = 0; i < num_nodes; i++) {
-        if (data_nodes[i].parent == node_id) {
-            if (!first) {
-                printf(",\n");
-            }
-            else {
-                printf("\n");
-                first = false;
-            }
-            if (data_nodes[i].type == TS_T_PATH) {
-                printf("%*s\"%s\" {", 4 * level, "", data_nodes[i].name);
-                dump_json(data_nodes[i].id, level + 1);
-                printf("\n%*s}", 4 * level, "");
-            }
-            else {
-                int pos = json_serialize_name_value((char *)buf, sizeof(buf), &data_nodes[i]);
-                if (pos > 0) {
-                    buf[pos-1] = '\0';  // remove trailing comma
-                    printf("%*s%s", 4 * level, "", (char *)buf);
-                }
+    ChildIterator it;
+    for (DataNode *node = first_child(it, node_id); node != NULL; node = next_child(it)) {
+        if (!first) {
+            printf(",\n");
+        }
+        else {
+            printf("\n");
+            first = false;
+        }
+        if (node->type == TS_T_PATH) {
+            printf("%*s\"%s\" {", 4 * level, "", node->name);
+            dump_json(node->id, level + 1);
+            printf("\n%*s}", 4 * level, "");
+        }
+        else {
+            Output out = {};
+            int pos = json_serialize_name_value(out, (char *)buf, sizeof(buf), node);
+            if (pos > 0) {
+                buf[pos-1] = '\0';  // remove trailing comma
+                printf("%*s%s", 4 * level, "", (char *)buf);
             }
         }
     }
@@ -255,6 +500,51 @@ void ThingSet::dump_json(node_id_t node_id, int level)
     }
 }
 
+void ThingSet::set_json_tokens(jsmntok_t *buf, size_t num)
+{
+    if (buf != NULL) {
+        tokens = buf;
+        num_tokens = num;
+    }
+    else {
+#if TS_NUM_JSON_TOKENS > 0
+        tokens = tokens_buf;
+#else
+        tokens = NULL;
+#endif
+        num_tokens = TS_NUM_JSON_TOKENS;
+    }
+    feed_state.tokens_valid = false;
+}
+
+int ThingSet::json_parse(jsmn_parser *parser, const char *js, size_t len)
+{
+    if (tokens == NULL) {
+        // no storage available: the parser fails as soon as a token has to be stored
+        jsmntok_t none;
+        return jsmn_parse(parser, js, len, &none, 0);
+    }
+    return jsmn_parse(parser, js, len, tokens, num_tokens);
+}
+
+int ThingSet::count_json_tokens(const uint8_t *request, size_t req_len)
+{
+    if (request == NULL || req_len < 1) {
+        return 0;
+    }
+
+    size_t path_len = req_len - 1;
+    const uint8_t *path_end = (const uint8_t *)memchr(request + 1, ' ', req_len - 1);
+    if (path_end) {
+        path_len = path_end - request - 1;
+    }
+
+    jsmn_parser parser;
+    jsmn_init(&parser);
+    return jsmn_parse(&parser, (const char *)request + 1 + path_len, req_len - path_len - 1,
+        NULL, 0);
+}
+
 int ThingSet::txt_process()
 {
     int path_len = req_len - 1;
@@ -264,6 +554,20 @@ int ThingSet::txt_process()
     }
 
     const DataNode *endpoint = get_endpoint((char *)req + 1, path_len);
+    if (endpoint) {
+        jsmn_parser parser;
+        jsmn_init(&parser);
+
+        json_str = (char *)req + 1 + path_len;
+        tok_count = json_parse(&parser, json_str, req_len - path_len - 1);
+    }
+    feed_state.tokens_valid = false;
+
+    return txt_dispatch(endpoint, path_len);
+}
+
+int ThingSet::txt_dispatch(const DataNode *endpoint, int path_len)
+{
     if (!endpoint) {
         if (req[0] == '?' && req[1] == '/' && path_len == 1) {
             return txt_get(NULL, false);
@@ -273,12 +577,6 @@ int ThingSet::txt_process()
         }
     }
 
-    jsmn_parser parser;
-    jsmn_init(&parser);
-
-    json_str = (char *)req + 1 + path_len;
-    tok_count = jsmn_parse(&parser, json_str, req_len - path_len - 1, tokens, sizeof(tokens));
-
     if (tok_count == JSMN_ERROR_NOMEM) {
         return txt_response(TS_STATUS_REQUEST_TOO_LARGE);
     }
@@ -334,6 +632,138 @@ int ThingSet::txt_process()
     return txt_response(TS_STATUS_BAD_REQUEST);
 }
 
+static bool _is_txt_request(uint8_t c)
+{
+    return c == '?' || c == '=' || c == '+' || c == '-' || c == '!';
+}
+
+void ThingSet::feed_init(uint8_t *buf, size_t size)
+{
+    feed_state.buf = buf;
+    feed_state.size = size;
+    feed_state.len = 0;
+    feed_state.path_len = -1;
+    feed_state.overflow = false;
+}
+
+void ThingSet::feed_path(int path_len)
+{
+    feed_state.path_len = path_len;
+    feed_state.endpoint = get_endpoint((char *)feed_state.buf + 1, path_len);
+    jsmn_init(&feed_state.parser);
+    feed_state.tok_count = 0;
+    feed_state.tokens_valid = true;
+}
+
+void ThingSet::feed_parse(size_t start)
+{
+    FeedState &fs = feed_state;
+    if (fs.len < 2 || !_is_txt_request(fs.buf[0])) {
+        return;
+    }
+
+    if (fs.path_len < 0) {
+        if (start < 1) {
+            start = 1;
+        }
+        uint8_t *path_end = (uint8_t *)memchr(&fs.buf[start], ' ', fs.len - start);
+        if (path_end == NULL) {
+            return;
+        }
+        feed_path(path_end - fs.buf - 1);
+    }
+
+    // continue where the previous run stopped, the parser resets its position to the start of
+    // an incomplete string or primitive
+    if (fs.endpoint != NULL && fs.tokens_valid &&
+        (fs.tok_count >= 0 || fs.tok_count == JSMN_ERROR_PART))
+    {
+        fs.tok_count = json_parse(&fs.parser, (char *)fs.buf + 1 + fs.path_len,
+            fs.len - fs.path_len - 1);
+    }
+}
+
+int ThingSet::feed(const uint8_t *data, size_t len, size_t &consumed, uint8_t *response,
+    size_t response_size)
+{
+    FeedState &fs = feed_state;
+    const uint8_t *end = (const uint8_t *)memchr(data, '\n', len);
+    size_t num = (end != NULL) ? end - data : len;
+    consumed = (end != NULL) ? num + 1 : len;
+
+    if (fs.buf == NULL || fs.size == 0) {
+        return 0;
+    }
+
+    if (fs.overflow || fs.len + num >= fs.size) {
+        // keep the beginning to identify the type of the request
+        memcpy(&fs.buf[fs.len], data, fs.size - 1 - fs.len);
+        fs.len = fs.size - 1;
+        fs.buf[fs.len] = '\0';
+        fs.overflow = true;
+    }
+    else if (num > 0) {
+        size_t start = fs.len;
+        memcpy(&fs.buf[fs.len], data, num);
+        fs.len += num;
+        fs.buf[fs.len] = '\0';
+        feed_parse(start);
+    }
+
+    if (end == NULL) {
+        return 0;   // wait for more data
+    }
+
+    // request complete
+    if (fs.len > 0 && fs.buf[fs.len - 1] == '\r') {
+        fs.buf[--fs.len] = '\0';
+    }
+
+    req = fs.buf;
+    req_len = fs.len;
+    resp = response;
+    resp_size = response_size;
+    Output out = {};
+    resp_out = &out;
+
+    int resp_len = 0;
+    if (fs.len == 0 || !_is_txt_request(fs.buf[0])) {
+        // not a thingset command --> ignore and set response to empty string
+        if (response_size > 0) {
+            response[0] = 0;
+        }
+    }
+    else if (fs.overflow) {
+        resp_len = txt_response(TS_STATUS_REQUEST_TOO_LARGE);
+    }
+    else {
+        if (fs.path_len < 0) {
+            feed_path(fs.len - 1);      // request without payload
+        }
+        if (fs.endpoint != NULL) {
+            if (!fs.tokens_valid) {
+                // tokens were used by another request in the meantime
+                jsmn_init(&fs.parser);
+                fs.tok_count = 0;
+            }
+            if (fs.tok_count >= 0 || fs.tok_count == JSMN_ERROR_PART) {
+                fs.tok_count = json_parse(&fs.parser, (char *)fs.buf + 1 + fs.path_len,
+                    fs.len - fs.path_len - 1);
+            }
+        }
+        json_str = (char *)fs.buf + 1 + fs.path_len;
+        tok_count = fs.tok_count;
+        resp_len = txt_dispatch(fs.endpoint, fs.path_len);
+    }
+
+    fs.len = 0;
+    fs.path_len = -1;
+    fs.overflow = false;
+    fs.tokens_valid = false;
+    resp_out = NULL;
+    return resp_len;
+}
+
 int ThingSet::txt_fetch(node_id_t parent_id)
 {
     size_t pos = 0;
@@ -376,9 +806,7 @@ int ThingSet::txt_fetch(node_id_t parent_id)
             }
         }
 
-        pos += json_serialize_value((char *)&resp[pos], resp_size - pos, node);
-
-        if (pos >= resp_size - 2) {
+        if (!json_append_node(*resp_out, (char *)resp, resp_size, pos, node, NODE_VALUE)) {
             return txt_response(TS_STATUS_RESPONSE_TOO_LARGE);
         }
         tok++;
@@ -386,7 +814,8 @@ int ThingSet::txt_fetch(node_id_t parent_id)
 
     pos--;  // remove trailing comma
     if (tokens[0].type == JSMN_ARRAY) {
-        // buffer will be long enough as we dropped last 2 characters --> sprintf allowed
+        // buffer will be long enough as we dropped the comma and json_serialize_value already
+        // wrote the null termination --> sprintf allowed
         pos += sprintf((char *)&resp[pos], "]");
     } else {
         resp[pos] = '\0';    // terminate string
@@ -401,28 +830,49 @@ int ThingSet::json_deserialize_value(char *buf, size_t len, jsmntype_t type, con
         return 0;
     }
 
-    errno = 0;
+    // numbers are parsed directly from the request and only stored if they are in range
+    uint64_t uvalue;
+    int64_t ivalue;
+    int res = 1;
     switch (node->type) {
         case TS_T_FLOAT32:
-            *((float*)node->data) = strtod(buf, NULL);
+            res = json_deserialize_float(buf, len, (float*)node->data);
             break;
         case TS_T_UINT64:
-            *((uint64_t*)node->data) = strtoull(buf, NULL, 0);
+            res = json_deserialize_uint64(buf, len, UINT64_MAX, &uvalue);
+            if (res) {
+                *((uint64_t*)node->data) = uvalue;
+            }
             break;
         case TS_T_INT64:
-            *((int64_t*)node->data) = strtoll(buf, NULL, 0);
+            res = json_deserialize_int64(buf, len, INT64_MIN, INT64_MAX, &ivalue);
+            if (res) {
+                *((int64_t*)node->data) = ivalue;
+            }
             break;
         case TS_T_UINT32:
-            *((uint32_t*)node->data) = strtoul(buf, NULL, 0);
+            res = json_deserialize_uint64(buf, len, UINT32_MAX, &uvalue);
+            if (res) {
+                *((uint32_t*)node->data) = uvalue;
+            }
             break;
         case TS_T_INT32:
-            *((int32_t*)node->data) = strtol(buf, NULL, 0);
+            res = json_deserialize_int64(buf, len, INT32_MIN, INT32_MAX, &ivalue);
+            if (res) {
+                *((int32_t*)node->data) = ivalue;
+            }
             break;
         case TS_T_UINT16:
-            *((uint16_t*)node->data) = strtoul(buf, NULL, 0);
+            res = json_deserialize_uint64(buf, len, UINT16_MAX, &uvalue);
+            if (res) {
+                *((uint16_t*)node->data) = uvalue;
+            }
             break;
         case TS_T_INT16:
-            *((uint16_t*)node->data) = strtol(buf, NULL, 0);
+            res = json_deserialize_int64(buf, len, INT16_MIN, INT16_MAX, &ivalue);
+            if (res) {
+                *((int16_t*)node->data) = ivalue;
+            }
             break;
         case TS_T_BOOL:
             if (buf[0] == 't' || buf[0] == '1') {
@@ -446,20 +896,50 @@ int ThingSet::json_deserialize_value(char *buf, size_t len, jsmntype_t type, con
             break;
     }
 
-    if (errno == ERANGE) {
+    if (res == 0) {
         return 0;
     }
 
     return 1;   // value always contained in one token (arrays not yet supported)
 }
 
+/*
+ * Returns the number of bytes of the value of a node with a fixed size (0 for other types)
+ */
+static size_t _value_size(uint8_t type)
+{
+    switch (type) {
+    case TS_T_BOOL:
+        return sizeof(bool);
+    case TS_T_UINT16:
+    case TS_T_INT16:
+        return sizeof(uint16_t);
+    case TS_T_UINT32:
+    case TS_T_INT32:
+    case TS_T_FLOAT32:
+        return sizeof(uint32_t);
+    case TS_T_UINT64:
+    case TS_T_INT64:
+        return sizeof(uint64_t);
+    default:
+        return 0;
+    }
+}
+
 int ThingSet::txt_patch(node_id_t parent_id)
 {
     int tok = 0;       // current token
 
-    // buffer for data node value (largest negative 64bit integer has 20 digits)
-    char value_buf[21];
-    size_t value_len;   // length of value in buffer
+    size_t value_len;
+
+    // validated nodes with decoded values, only written if all elements of the request are valid
+    struct {
+        const DataNode *node;
+        uint64_t value;         // enough to fit also 64-bit values
+        int tok;                // token of the value (used for strings)
+    } staged[TS_NUM_PATCH_STAGED];
+    size_t num_staged = 0;
+    int tok_unstaged = tok_count;   // first token of elements that did not fit into staged
 
     if (tok_count < 2) {
         if (tok_count == JSMN_ERROR_NOMEM) {
@@ -473,7 +953,7 @@ int ThingSet::txt_patch(node_id_t parent_id)
         tok++;
     }
 
-    // loop through all elements to check if request is valid
+    // loop through all elements to check if request is valid and decode the values
     while (tok + 1 < tok_count) {
 
         if (tokens[tok].type != JSMN_STRING ||
@@ -500,37 +980,52 @@ int ThingSet::txt_patch(node_id_t parent_id)
 
         tok++;
 
-        // extract the value and check buffer lengths
+        // check buffer length of strings
         value_len = tokens[tok].end - tokens[tok].start;
-        if ((node->type != TS_T_STRING && value_len >= sizeof(value_buf)) ||
-            (node->type == TS_T_STRING && value_len >= (size_t)node->detail))
-        {
+        if (node->type == TS_T_STRING && value_len >= (size_t)node->detail) {
             return txt_response(TS_STATUS_UNSUPPORTED_FORMAT);
         }
-        else {
-            strncpy(value_buf, &json_str[tokens[tok].start], value_len);
-            value_buf[value_len] = '\0';
-        }
 
-        // create dummy node to test formats
-        uint8_t dummy_data[8];          // enough to fit also 64-bit values
-        DataNode dummy_node = {0, 0, "Dummy", (void *)dummy_data, node->type, node->detail};
+        // decode into staging area using a dummy node (strings are copied from the request)
+        uint64_t dummy_data;
+        void *value = &dummy_data;
+        if (num_staged < sizeof(staged) / sizeof(staged[0])) {
+            staged[num_staged].node = node;
+            staged[num_staged].tok = tok;
+            value = &staged[num_staged].value;
+        }
+        else if (tok_unstaged == tok_count) {
+            tok_unstaged = tok - 1;
+        }
+        DataNode dummy_node = {0, 0, "Dummy", value, node->type, node->detail};
 
-        int res = json_deserialize_value(value_buf, value_len, tokens[tok].type, &dummy_node);
+        int res = json_deserialize_value(&json_str[tokens[tok].start], value_len,
+            tokens[tok].type, &dummy_node);
         if (res == 0) {
             return txt_response(TS_STATUS_UNSUPPORTED_FORMAT);
         }
+        if (value != &dummy_data) {
+            num_staged++;
+        }
         tok += res;
     }
 
-    if (tokens[0].type == JSMN_OBJECT) {
-        tok = 1;
-    }
-    else {
-        tok = 0;
+    // actually write data
+    for (size_t i = 0; i < num_staged; i++) {
+        const DataNode *node = staged[i].node;
+        if (node->type == TS_T_STRING) {
+            const jsmntok_t *value_tok = &tokens[staged[i].tok];
+            value_len = value_tok->end - value_tok->start;
+            memcpy(node->data, &json_str[value_tok->start], value_len);
+            ((char *)node->data)[value_len] = '\0';
+        }
+        else {
+            memcpy(node->data, &staged[i].value, _value_size(node->type));
+        }
     }
 
-    // actually write data
+    // look up and decode remaining elements again (validated before)
+    tok = tok_unstaged;
     while (tok + 1 < tok_count) {
 
         const DataNode *node = get_node(json_str + tokens[tok].start,
@@ -538,13 +1033,7 @@ int ThingSet::txt_patch(node_id_t parent_id)
 
         tok++;
 
-        // extract the value again (max. size was checked before)
         value_len = tokens[tok].end - tokens[tok].start;
-        if (value_len < sizeof(value_buf)) {
-            strncpy(value_buf, &json_str[tokens[tok].start], value_len);
-            value_buf[value_len] = '\0';
-        }
-
         tok += json_deserialize_value(&json_str[tokens[tok].start], value_len, tokens[tok].type,
             node);
     }
@@ -564,7 +1053,10 @@ int ThingSet::txt_get(const DataNode *parent_node, bool include_values)
     {
         // get value of data node
         resp[len++] = ' ';
-        len += json_serialize_value((char *)&resp[len], resp_size - len, parent_node);
+        if (!json_append_node(*resp_out, (char *)resp, resp_size, len, parent_node,
+                NODE_VALUE)) {
+            return txt_response(TS_STATUS_RESPONSE_TOO_LARGE);
+        }
         resp[--len] = '\0';     // remove trailing comma again
         return len;
     }
@@ -576,34 +1068,18 @@ int ThingSet::txt_get(const DataNode *parent_node, bool include_values)
 
     len += sprintf((char *)&resp[len], include_values ? " {" : " [");
     int nodes_found = 0;
-    for (unsigned int i = 0; i < num_nodes; i++) {
-        if ((data_nodes[i].access & TS_READ_MASK) &&
-            (data_nodes[i].parent == parent_node_id))
-        {
-            if (include_values) {
-                if (data_nodes[i].type == TS_T_PATH) {
-                    // bad request, as we can't read nternal path node's values
-                    return txt_response(TS_STATUS_BAD_REQUEST);
-                }
-                int ret = json_serialize_name_value((char *)&resp[len], resp_size - len,
-                    &data_nodes[i]);
-                if (ret > 0) {
-                    len += ret;
-                }
-                else {
-                    return txt_response(TS_STATUS_RESPONSE_TOO_LARGE);
-                }
-            }
-            else {
-                len += snprintf((char *)&resp[len],
-                    resp_size - len,
-                    "\"%s\",", data_nodes[i].name);
+    ChildIterator it;
+    for (DataNode *node = first_child(it, parent_node_id); node != NULL; node = next_child(it)) {
+        if (node->access & TS_READ_MASK) {
+            if (include_values && node->type == TS_T_PATH) {
+                // bad request, as we can't read nternal path node's values
+                return txt_response(TS_STATUS_BAD_REQUEST);
             }
-            nodes_found++;
-
-            if (len >= resp_size - 1) {
+            if (!json_append_node(*resp_out, (char *)resp, resp_size, len, node,
+                    include_values ? NODE_NAME_VALUE : NODE_NAME)) {
                 return txt_response(TS_STATUS_RESPONSE_TOO_LARGE);
             }
+            nodes_found++;
         }
     }
 
@@ -663,7 +1139,7 @@ int ThingSet::txt_create(const DataNode *node)
             DataNode *del_node = get_node(json_str + tokens[0].start,
                 tokens[0].end - tokens[0].start);
             if (del_node != NULL) {
-                del_node->pubsub |= (uint16_t)node->detail;
+                set_pubsub(del_node, del_node->pubsub | (uint16_t)node->detail);
                 return txt_response(TS_STATUS_CREATED);
             }
             return txt_response(TS_STATUS_NOT_FOUND);
@@ -709,7 +1185,7 @@ int ThingSet::txt_delete(const DataNode *node)
             DataNode *del_node = get_node(json_str + tokens[0].start,
                 tokens[0].end - tokens[0].start);
             if (del_node != NULL) {
-                del_node->pubsub &= ~((uint16_t)node->detail);
+                set_pubsub(del_node, del_node->pubsub & ~((uint16_t)node->detail));
                 return txt_response(TS_STATUS_DELETED);
             }
             return txt_response(TS_STATUS_NOT_FOUND);
@@ -737,21 +1213,20 @@ int ThingSet::txt_exec(const DataNode *node)
         return txt_response(TS_STATUS_FORBIDDEN);
     }
 
-    for (unsigned int i = 0; i < num_nodes; i++) {
-        if (data_nodes[i].parent == node->id) {
-            if (tok >= tok_count) {
-                // more child nodes found than parameters were passed
-                return txt_response(TS_STATUS_BAD_REQUEST);
-            }
-            int res = json_deserialize_value(json_str + tokens[tok].start,
-                tokens[tok].end - tokens[tok].start, tokens[tok].type, &data_nodes[i]);
-            if (res == 0) {
-                // deserializing the value was not successful
-                return txt_response(TS_STATUS_UNSUPPORTED_FORMAT);
-            }
-            tok += res;
-            nodes_found++;
+    ChildIterator it;
+    for (DataNode *child = first_child(it, node->id); child != NULL; child = next_child(it)) {
+        if (tok >= tok_count) {
+            // more child nodes found than parameters were passed
+            return txt_response(TS_STATUS_BAD_REQUEST);
+        }
+        int res = json_deserialize_value(json_str + tokens[tok].start,
+            tokens[tok].end - tokens[tok].start, tokens[tok].type, child);
+        if (res == 0) {
+            // deserializing the value was not successful
+            return txt_response(TS_STATUS_UNSUPPORTED_FORMAT);
         }
+        tok += res;
+        nodes_found++;
     }
 
     if (tok_count > tok) {
@@ -766,19 +1241,181 @@ int ThingSet::txt_exec(const DataNode *node)
     return txt_response(TS_STATUS_VALID);
 }
 
+bool ThingSet::render_pub_template(PubTemplate *tpl, uint16_t pub_ch)
+{
+    size_t num = num_pub_nodes(pub_ch);
+    size_t text_len = 3;    // "# {"
+    PubIterator it;
+    for (DataNode *node = first_pub_node(it, pub_ch); node != NULL; node = next_pub_node(it)) {
+        text_len += _json_name_len(node->name, name_len(node));
+    }
+
+    // one additional element, as malloc may return NULL for size 0
+    char *text = (char *)malloc(text_len + 1);
+    DataNode **nodes = (DataNode **)malloc((num + 1) * sizeof(DataNode *));
+    size_t *text_end = (size_t *)malloc((num + 1) * sizeof(size_t));
+    if (text == NULL || nodes == NULL || text_end == NULL) {
+        free(text);
+        free(nodes);
+        free(text_end);
+        return false;
+    }
+
+    size_t pos = snprintf(text, text_len + 1, "# {");
+    size_t i = 0;
+    for (DataNode *node = first_pub_node(it, pub_ch); node != NULL && i < num;
+            node = next_pub_node(it), i++) {
+        pos += _json_serialize_name(&text[pos], text_len + 1 - pos, node->name, name_len(node),
+            ':');
+        nodes[i] = node;
+        text_end[i] = pos;
+    }
+
+    free(tpl->text);
+    free(tpl->nodes);
+    free(tpl->text_end);
+    tpl->text = text;
+    tpl->nodes = nodes;
+    tpl->text_end = text_end;
+    tpl->num_nodes = i;
+    tpl->valid = true;
+    return true;
+}
+
+int ThingSet::txt_pub_template(char *buf, size_t size, uint16_t pub_ch)
+{
+    PubTemplate *tpl = valid_pub_template(pub_ch);
+    if (tpl == NULL) {
+        return -1;
+    }
+
+    size_t pos = 0;
+    size_t start = 0;
+    for (size_t i = 0; i < tpl->num_nodes; i++) {
+        const DataNode *node = tpl->nodes[i];
+        if (pub_bits == NULL && (node->pubsub & pub_ch) == 0) {
+            // pubsub flags were changed by the application without set_pubsub (otherwise the
+            // channel sets are used, which are updated together with the template)
+            tpl->valid = false;
+            return -1;
+        }
+        size_t len = tpl->text_end[i] - start;
+        if (pos + len >= size) {
+            return 0;
+        }
+        memcpy(&buf[pos], &tpl->text[start], len);
+        pos += len;
+        start = tpl->text_end[i];
+
+        len = json_serialize_value(&buf[pos], size - pos, node);
+        if (len == 0) {
+            return 0;
+        }
+        pos += len;
+    }
+
+    if (tpl->num_nodes > 0) {
+        buf[pos - 1] = '}';    // overwrite comma
+    }
+    else if (size >= 5) {
+        pos = snprintf(buf, size, "# {}");
+    }
+    else {
+        return 0;
+    }
+    return pos;
+}
+
 int ThingSet::txt_pub(char *buf, size_t buf_size, const uint16_t pub_ch)
 {
-    unsigned int len = sprintf(buf, "# {");
+    Output out = {};
+    return txt_pub(out, buf, buf_size, pub_ch);
+}
+
+int ThingSet::txt_pub(Output &out, char *buf, size_t buf_size, const uint16_t pub_ch)
+{
+    size_t count = 0;
+    const uint8_t *selected = select_pub_delta(pub_ch, count, !out.measure);
+    if (selected != NULL && count == 0) {
+        return 0;   // no changes in delta mode
+    }
 
-    for (unsigned int i = 0; i < num_nodes; i++) {
-        if (data_nodes[i].pubsub & pub_ch) {
-            len += json_serialize_name_value(&buf[len], buf_size - len, &data_nodes[i]);
+    if (selected == NULL && out.iov == NULL && out.sink == NULL && !out.measure) {
+        int len = txt_pub_template(buf, buf_size, pub_ch);
+        if (len >= 0) {
+            return len;
         }
-        if (len >= buf_size - 1) {
+    }
+
+    size_t len = snprintf(buf, buf_size, "# {");
+    if (len >= buf_size) {
+        request_full_pub(pub_ch);
+        return 0;
+    }
+
+    PubIterator it;
+    size_t i = 0;
+    bool empty = true;
+    for (DataNode *node = first_pub_node(it, pub_ch); node != NULL;
+            node = next_pub_node(it), i++) {
+        if (!pub_delta_selected(selected, i)) {
+            continue;
+        }
+        if (!json_append_node(out, buf, buf_size, len, node, NODE_NAME_VALUE)) {
+            request_full_pub(pub_ch);
             return 0;
         }
+        empty = false;
+    }
+
+    if (!empty) {
+        buf[len-1] = '}';    // overwrite comma
+    }
+    else if (len + 2 <= buf_size) {
+        buf[len++] = '}';
+        buf[len] = '\0';
+    }
+    else {
+        return 0;
     }
-    buf[len-1] = '}';    // overwrite comma
 
     return len;
 }
+
+int ThingSet::txt_pub_size(const uint16_t pub_ch)
+{
+    char buf[5];    // only used for the message header (or "# {}" for an empty message)
+    Output out = {};
+    out.measure = true;
+
+    size_t len = txt_pub(out, buf, sizeof(buf), pub_ch);
+    return (len > 0) ? out.sent + len : 0;
+}
+
+int ThingSet::txt_pub(TsIoVec *iov_buf, int iov_buf_max, char *scratch, size_t scratch_size,
+    const uint16_t pub_ch)
+{
+    Output out = {};
+    out.iov = iov_buf;
+    out.iov_max = iov_buf_max;
+    out.iov_mark = scratch;
+
+    size_t len = txt_pub(out, scratch, scratch_size, pub_ch);
+    bool last = len > 0 && iov_add(out, out.iov_mark, scratch + len - out.iov_mark);
+    return last ? out.iov_count : 0;
+}
+
+int ThingSet::txt_pub(char *buf, size_t buf_size, const uint16_t pub_ch, TsStreamSink sink,
+    void *ctx)
+{
+    Output out = {};
+    out.sink = sink;
+    out.ctx = ctx;
+
+    size_t len = txt_pub(out, buf, buf_size, pub_ch);
+    int total = (len > 0 && stream_flush(out, (uint8_t *)buf, len)) ? out.sent : 0;
+    if (len > 0 && total == 0) {
+        request_full_pub(pub_ch);   // last chunk could not be sent
+    }
+    return total;
+}
@@ -13,11 +13,38 @@
  *
  * Thingset throws an error if maximum number of tokens is reached in a
  * request or response.
+ *
+ * The tokens are stored inside each ThingSet instance. Set to 0 to save the
+ * RAM if only binary mode is used or if the tokens are provided by the
+ * application via ThingSet::set_json_tokens.
  */
 #ifndef TS_NUM_JSON_TOKENS
 #define TS_NUM_JSON_TOKENS 50
 #endif
 
+/*
+ * Maximum number of values of a text mode PATCH request that are decoded
+ * only once during validation. Additional values are decoded again before
+ * they are written.
+ *
+ * Each staged value needs 16 (32-bit MCUs) to 24 bytes of stack, so only a few
+ * values are staged by default.
+ */
+#ifndef TS_NUM_PATCH_STAGED
+#define TS_NUM_PATCH_STAGED 4
+#endif
+
+/*
+ * Minimum length of node names referenced in place by scatter-gather responses
+ *
+ * Shorter names are copied to the scratch buffer, as an additional fragment costs more (in
+ * ThingSet and in the DMA descriptors of the transport) than copying a few bytes. Set to 0 to
+ * reference all names.
+ */
+#ifndef TS_IOV_MIN_NAME_LEN
+#define TS_IOV_MIN_NAME_LEN 8
+#endif
+
 /*
  * If verbose status messages are switched on, a response in text-based mode
  * contains not only the status code, but also a message.
@@ -36,4 +63,65 @@
 #define TS_64BIT_TYPES_SUPPORT 0        // default: no support
 #endif
 
+/*
+ * Number of resolved paths (e.g. "conf" or "pub/serial/IDs") cached by each ThingSet object
+ *
+ * Frequently requested paths are looked up in the cache instead of being resolved segment by
+ * segment. The least recently used path is replaced if the cache is full. Set to 0 to disable
+ * the cache, e.g. if lookups from several threads must not write to the ThingSet object.
+ */
+#ifndef TS_PATH_CACHE_SIZE
+#define TS_PATH_CACHE_SIZE 8
+#endif
+
+/*
+ * Switch on 32-bit node IDs (default: 16-bit)
+ *
+ * Needed for data node trees with more than 65535 nodes or if IDs are assigned in sparse
+ * ranges, e.g. a gateway with a separate ID range for each connected device. The binary mode
+ * stays compatible, as CBOR always uses the shortest encoding of an ID. IDs must be below
+ * 0x80000000 and nodes with IDs above 0xFFFF can't be published via CAN.
+ */
+#ifndef TS_32BIT_NODE_IDS
+#define TS_32BIT_NODE_IDS 0
+#endif
+
+/*
+ * Use 32-bit offsets in the JSON tokens instead of 16-bit, so that text mode payloads can be
+ * larger than 32 kB (e.g. bulk uploads on gateways). Each token needs 4 bytes more RAM.
+ */
+#ifndef TS_32BIT_JSON_OFFSETS
+#define TS_32BIT_JSON_OFFSETS 0
+#endif
+
+/*
+ * Let the JSON parser skip over the characters of strings and numbers in blocks of 8 bytes
+ * (or 16/32 bytes with SSE2, AVX2 or NEON) instead of checking them one by one. Mainly
+ * speeds up long payloads, e.g. on gateways.
+ */
+#ifndef TS_JSON_SIMD_SCAN
+#define TS_JSON_SIMD_SCAN 1
+#endif
+
+/*
+ * Find data nodes by ID using a hash table instead of a binary search
+ *
+ * The lookup time of the hash table does not depend on the number of nodes, but it needs
+ * about twice the RAM of the sorted ID index. Enabled by default for 32-bit node IDs.
+ */
+#ifndef TS_NODE_ID_HASH_TABLE
+#define TS_NODE_ID_HASH_TABLE TS_32BIT_NODE_IDS
+#endif
+
+/*
+ * Serialize all float values in text mode with the shortest representation that is parsed back
+ * to the same value instead of the fixed number of decimal digits specified for each node
+ *
+ * Individual nodes can use the shortest representation by specifying TS_FLOAT_SHORTEST as
+ * number of digits.
+ */
+#ifndef TS_JSON_SHORTEST_FLOATS
+#define TS_JSON_SHORTEST_FLOATS 0
+#endif
+
 #endif /* __TS_CONFIG_H_ */
@@ -8,6 +8,7 @@
 #include "unity.h"
 
 #include "test_data.h"
+#include "test_data_index.h"
 #include "test_functions.h"
 #include "tests.h"
 
@@ -22,10 +23,28 @@ void tearDown (void) {}
 uint8_t req_buf[TS_REQ_BUFFER_LEN];
 uint8_t resp_buf[TS_RESP_BUFFER_LEN];
 
+jsmntok_t json_tokens[TEST_NUM_JSON_TOKENS];
+
 ThingSet ts(data_nodes, sizeof(data_nodes)/sizeof(DataNode));
 
+// same data nodes, but with lookup tables generated at compile time
+ThingSet ts_const_index(data_nodes, sizeof(data_nodes)/sizeof(DataNode), data_nodes_index);
+
+// tables with a wrong checksum (e.g. names changed without running dump_index again), which have
+// to be ignored, as the ID index would not find any node
+constexpr TsIdIndexEntry stale_id_index[sizeof(data_nodes_id_index) / sizeof(TsIdIndexEntry)] = {};
+constexpr TsNodeIndex stale_index = {
+    data_nodes_index.num_nodes, data_nodes_index.checksum ^ 1,
+    stale_id_index, data_nodes_children, data_nodes_child_start, data_nodes_name_info
+};
+ThingSet ts_stale_index(data_nodes, sizeof(data_nodes)/sizeof(DataNode), stale_index);
+
 int main()
 {
+    ts.set_json_tokens(json_tokens, TEST_NUM_JSON_TOKENS);
+    ts_const_index.set_json_tokens(json_tokens, TEST_NUM_JSON_TOKENS);
+    ts_stale_index.set_json_tokens(json_tokens, TEST_NUM_JSON_TOKENS);
+
     tests_common();
     tests_text_mode();
     tests_binary_mode();
@@ -193,6 +193,7 @@ static DataNode data_nodes[] = {
     TS_NODE_PATH(0x1000, "test", 0, NULL),
 
     TS_NODE_INT32(0x4001, "i32_readonly", &i32, 0x1000, TS_ANY_R, 0),
+    TS_NODE_INT32(0x4002, "i32_writeonly", &i32, 0x1000, TS_ANY_W, 0),
 
     TS_NODE_EXEC(0x5001, "dummy", &dummy, ID_EXEC, TS_ANY_RW),
 
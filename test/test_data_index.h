@@ -0,0 +1,61 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Copyright (c) 2020 Martin Jäger / Libre Solar
+ */
+
+#ifndef TEST_DATA_INDEX_H
+#define TEST_DATA_INDEX_H
+
+#include "test_data.h"
+
+/*
+ * Node lookup tables for data_nodes
+ *
+ * Generated by ThingSet::dump_index(), re-generate after any change of the nodes.
+ */
+
+constexpr TsIdIndexEntry data_nodes_id_index[] = {
+    {0x18, 0}, {0x19, 1}, {0x1A, 2}, {0x1B, 3}, {0x30, 4}, {0x31, 5},
+    {0x32, 6}, {0x60, 7}, {0x61, 8}, {0x70, 9}, {0x71, 10}, {0x72, 11},
+    {0x73, 12}, {0xA0, 13}, {0xA1, 14}, {0xA2, 15}, {0xA3, 16}, {0xD0, 17},
+    {0xE0, 18}, {0xE1, 19}, {0xE2, 20}, {0xE3, 21}, {0xF0, 22}, {0xF1, 23},
+    {0xF2, 24}, {0xF3, 25}, {0xF4, 26}, {0xF5, 27}, {0xF6, 28}, {0xF7, 29},
+    {0xF8, 30}, {0x100, 31}, {0x110, 32}, {0x130, 33}, {0x1000, 34}, {0x4001, 35},
+    {0x4002, 36}, {0x5001, 37}, {0x6001, 38}, {0x6002, 39}, {0x6003, 40}, {0x6004, 41},
+    {0x6005, 42}, {0x6006, 43}, {0x6007, 44}, {0x6008, 45}, {0x6009, 46}, {0x600A, 47},
+    {0x7001, 48}, {0x7002, 49}, {0x7003, 50}, {0x7004, 51}, {0x8000, 52},
+};
+
+constexpr node_pos_t data_nodes_children[] = {
+    1, 2, 3, 5, 6, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48,
+    49, 50, 51, 52, 8, 10, 11, 12, 14, 15, 16, 19, 37, 21, 23, 27,
+    24, 25, 26, 28, 29, 30, 32, 33, 35, 36, 0, 4, 7, 9, 13, 17,
+    18, 20, 22, 31, 34,
+};
+
+constexpr node_pos_t data_nodes_child_start[] = {
+    0, 3, 3, 3, 3, 20, 20, 20, 21, 21, 24, 24, 24, 24, 27, 27,
+    27, 27, 27, 29, 29, 30, 30, 32, 35, 35, 35, 35, 38, 38, 38, 38,
+    40, 40, 40, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42, 42,
+    42, 42, 42, 42, 42, 42, 53, 53,
+};
+
+constexpr TsNameInfo data_nodes_name_info[] = {
+    {4, 185}, {12, 129}, {11, 252}, {8, 188}, {4, 2}, {13, 37}, {16, 182}, {5, 53},
+    {14, 228}, {6, 155}, {5, 55}, {5, 172}, {12, 161}, {3, 253}, {11, 250}, {10, 216},
+    {18, 80}, {3, 147}, {4, 194}, {5, 155}, {4, 77}, {8, 223}, {3, 78}, {6, 162},
+    {6, 213}, {11, 9}, {3, 174}, {3, 216}, {6, 213}, {11, 9}, {3, 174}, {3, 110},
+    {6, 46}, {5, 205}, {4, 235}, {12, 105}, {13, 9}, {5, 193}, {4, 230}, {3, 25},
+    {4, 199}, {3, 60}, {4, 197}, {3, 239}, {3, 41}, {4, 244}, {6, 20}, {11, 39},
+    {13, 93}, {12, 198}, {8, 86}, {10, 80}, {8, 64},
+};
+
+constexpr TsNodeIndex data_nodes_index = {
+    53, 0xCD7A5CC9,
+    data_nodes_id_index, data_nodes_children, data_nodes_child_start, data_nodes_name_info
+};
+
+TS_NODE_INDEX_CHECK(data_nodes, data_nodes_index);
+
+#endif
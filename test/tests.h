@@ -10,6 +10,9 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "jsmn.h"
+#include "ts_config.h"
+
 /*
  * Same as in test_data.h
  */
@@ -25,6 +28,15 @@
 #define ID_SUB      0xF1        // subscription setup
 #define ID_LOG      0x100       // access log data
 
+/*
+ * Expected JSON representation of a float value, depending on TS_JSON_SHORTEST_FLOATS
+ */
+#if TS_JSON_SHORTEST_FLOATS
+#define JSON_FLOAT(fixed, shortest) shortest
+#else
+#define JSON_FLOAT(fixed, shortest) fixed
+#endif
+
 #define PUB_SER     (1U << 0)   // UART serial
 #define PUB_CAN     (1U << 1)   // CAN bus
 #define PUB_NVM     (1U << 2)   // data that should be stored in EEPROM
@@ -32,6 +44,13 @@
 #define TS_REQ_BUFFER_LEN 500
 #define TS_RESP_BUFFER_LEN 500
 
+/*
+ * Token storage shared by all ThingSet instances of the tests, so that they also work with
+ * TS_NUM_JSON_TOKENS set to 0
+ */
+#define TEST_NUM_JSON_TOKENS 50
+extern jsmntok_t json_tokens[TEST_NUM_JSON_TOKENS];
+
 void tests_common();
 void tests_text_mode();
 void tests_binary_mode();
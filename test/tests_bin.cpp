@@ -44,6 +44,24 @@ void test_bin_get_output_ids()
     TEST_ASSERT_EQUAL_HEX8_ARRAY(resp_expected, resp, len);
 }
 
+void test_bin_get_readable_ids_only()
+{
+    uint8_t req[] = { TS_GET, 0x19, 0x10, 0x00, 0xF7 };    // node 0x1000 with write-only child
+
+    uint8_t resp[100];
+    int resp_len = ts.process(req, sizeof(req), resp, sizeof(resp));
+
+    char resp_hex[] =
+        "85 81 "     // successful response: array with 1 element
+        "19 40 01 ";
+
+    uint8_t resp_expected[100];
+    int len = hex2bin(resp_hex, resp_expected, sizeof(resp_expected));
+
+    TEST_ASSERT_EQUAL(len, resp_len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(resp_expected, resp, len);
+}
+
 void test_bin_get_output_names()
 {
     uint8_t req[] = { TS_GET, 0x18, ID_OUTPUT, 0x80 };
@@ -85,6 +103,33 @@ void test_bin_get_output_names_values()
     TEST_ASSERT_EQUAL_HEX8_ARRAY(resp_expected, resp, len);
 }
 
+void test_bin_response_size()
+{
+    uint8_t requests[][5] = {
+        { TS_GET, 0x18, ID_OUTPUT, 0xF7 },
+        { TS_GET, 0x18, ID_OUTPUT, 0x80 },
+        { TS_GET, 0x18, ID_OUTPUT, 0xA0 },
+        { TS_GET, 0x18, ID_CONF, 0xA0 },
+        { TS_GET, 0x19, 0x10, 0x00, 0xF7 },     // node 0x1000 with write-only child
+        { TS_FETCH, 0x18, ID_OUTPUT, 0x18, 0x71 },
+        { TS_FETCH, 0x18, ID_OUTPUT, 0x18, 0x01 },  // not found
+    };
+
+    uint8_t resp[TS_RESP_BUFFER_LEN];
+    for (unsigned int i = 0; i < sizeof(requests) / sizeof(requests[0]); i++) {
+        int size = ts.process_size(requests[i], sizeof(requests[i]));
+        int resp_len = ts.process(requests[i], sizeof(requests[i]), resp, sizeof(resp));
+        TEST_ASSERT_EQUAL(resp_len, size);
+    }
+
+    TEST_ASSERT_EQUAL(ts.bin_pub(resp, sizeof(resp), PUB_SER), ts.bin_pub_size(PUB_SER));
+
+    // length is measured by the same functions as used for serialization
+    TEST_ASSERT_EQUAL(9, cbor_serialize_uint(NULL, 0x100000000ULL, 0));
+    TEST_ASSERT_EQUAL(3, cbor_serialize_int(NULL, -257, 0));
+    TEST_ASSERT_EQUAL(259, cbor_serialize_bytes(NULL, resp, 256, 0));
+}
+
 void test_bin_patch_multiple_nodes()
 {
     char req_hex[] =
@@ -268,6 +313,55 @@ void test_bin_pub()
     int len = hex2bin(hex_expected, bin_expected, sizeof(bin_expected));
 
     TEST_ASSERT_EQUAL_HEX8_ARRAY(bin_expected, bin, len);
+
+    // flags changed directly by the application are used after rebuilding the channel sets
+    DataNode *bat_a = ts.get_node(0x72);
+    bat_a->pubsub &= ~PUB_SER;
+    TEST_ASSERT_EQUAL(len, ts.bin_pub(bin, sizeof(bin), PUB_SER));
+    TEST_ASSERT_EQUAL_HEX8(0xA4, bin[1]);
+    ts.update_pub_index();
+    TEST_ASSERT_EQUAL(len - 7, ts.bin_pub(bin, sizeof(bin), PUB_SER));
+    TEST_ASSERT_EQUAL_HEX8(0xA3, bin[1]);
+    bat_a->pubsub |= PUB_SER;
+    ts.update_pub_index();
+}
+
+static int bin_stream_sink(const uint8_t *data, size_t len, void *ctx)
+{
+    uint8_t **pos = (uint8_t **)ctx;
+    memcpy(*pos, data, len);
+    *pos += len;
+    return 0;
+}
+
+void test_bin_pub_streamed()
+{
+    uint8_t bin[100];
+    int len = ts.bin_pub(bin, sizeof(bin), PUB_SER);
+
+    uint8_t chunk[10];
+    uint8_t streamed[100];
+    uint8_t *pos = streamed;
+    TEST_ASSERT_EQUAL(0, ts.bin_pub(chunk, sizeof(chunk), PUB_SER));
+    TEST_ASSERT_EQUAL(len, ts.bin_pub(chunk, sizeof(chunk), PUB_SER, bin_stream_sink, &pos));
+    TEST_ASSERT_EQUAL(len, pos - streamed);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(bin, streamed, len);
+}
+
+void test_bin_get_streamed()
+{
+    uint8_t req[] = { TS_GET, 0x18, ID_OUTPUT, 0xA0 };
+
+    uint8_t resp[100];
+    int len = ts.process(req, sizeof(req), resp, sizeof(resp));
+
+    uint8_t chunk[16];
+    uint8_t streamed[100];
+    uint8_t *pos = streamed;
+    TEST_ASSERT_EQUAL(len, ts.process(req, sizeof(req), chunk, sizeof(chunk), bin_stream_sink,
+        &pos));
+    TEST_ASSERT_EQUAL(len, pos - streamed);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(resp, streamed, len);
 }
 
 void test_bin_pub_can()
@@ -361,6 +455,20 @@ void test_bin_serialize_long_string()
     TEST_ASSERT_EQUAL_UINT(0x00, buf[2]);           // null-termination is not stored
 }
 
+void test_bin_serialize_string_exact_fit()
+{
+    uint8_t buf[6] = { 0, 0, 0, 0, 0, 0xAA };
+
+    // no null termination is written behind the string
+    TEST_ASSERT_EQUAL(5, cbor_serialize_string(buf, "abcd", 5));
+    TEST_ASSERT_EQUAL_HEX8(0x64, buf[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xAA, buf[5]);
+
+    TEST_ASSERT_EQUAL(3, cbor_serialize_string_len(buf, "abcd", 2, 5));
+    TEST_ASSERT_EQUAL_HEX8(0x62, buf[0]);
+    TEST_ASSERT_EQUAL(0, cbor_serialize_string_len(buf, "abcd", 4, 4));
+}
+
 void test_bin_serialize_bytes()
 {
     uint8_t bytes[300];
@@ -427,14 +535,51 @@ void test_bin_patch_fetch_bytes()
     TEST_ASSERT_EQUAL_HEX8_ARRAY(resp_expected, resp, sizeof(resp_expected));
 }
 
+void test_bin_serialize_arrays()
+{
+    uint8_t buf[100];
+    uint8_t ref[100];
+    int32_t i32[] = { 0, 23, 24, -24, -25, 255, 256, -256, -257, 65535, 65536, INT32_MIN };
+    int num = sizeof(i32) / sizeof(i32[0]);
+
+    // same result as serializing each element separately
+    int len = cbor_serialize_array(ref, num, sizeof(ref));
+    for (int i = 0; i < num; i++) {
+        len += cbor_serialize_int(&ref[len], i32[i], sizeof(ref) - len);
+    }
+    TEST_ASSERT_EQUAL(len, cbor_serialize_array_int32(buf, i32, num, sizeof(buf)));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(ref, buf, len);
+    TEST_ASSERT_EQUAL(len, cbor_serialize_array_int32(NULL, i32, num, 0));
+
+    // exact bounds check close to the end of the buffer
+    for (int size = 0; size < len; size++) {
+        TEST_ASSERT_EQUAL(0, cbor_serialize_array_int32(buf, i32, num, size));
+    }
+
+    int16_t i16[] = { -1, 300, -300, INT16_MIN };
+    uint8_t i16_cbor[] = { 0x84, 0x20, 0x19, 0x01, 0x2C, 0x39, 0x01, 0x2B, 0x39, 0x7F, 0xFF };
+    TEST_ASSERT_EQUAL(sizeof(i16_cbor), cbor_serialize_array_int16(buf, i16, 4, sizeof(buf)));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(i16_cbor, buf, sizeof(i16_cbor));
+    TEST_ASSERT_EQUAL(0, cbor_serialize_array_int16(buf, i16, 4, sizeof(i16_cbor) - 1));
+
+    float f32[] = { 2.27F, -1.0F };
+    uint8_t f32_cbor[] = { 0x82, 0xFA, 0x40, 0x11, 0x47, 0xAE, 0xFA, 0xBF, 0x80, 0x00, 0x00 };
+    TEST_ASSERT_EQUAL(sizeof(f32_cbor), cbor_serialize_array_float(buf, f32, 2, sizeof(buf)));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(f32_cbor, buf, sizeof(f32_cbor));
+    TEST_ASSERT_EQUAL(sizeof(f32_cbor), cbor_serialize_array_float(NULL, f32, 2, 0));
+    TEST_ASSERT_EQUAL(0, cbor_serialize_array_float(buf, f32, 2, sizeof(f32_cbor) - 1));
+}
+
 void tests_binary_mode()
 {
     UNITY_BEGIN();
 
     // GET request
     RUN_TEST(test_bin_get_output_ids);
+    RUN_TEST(test_bin_get_readable_ids_only);
     RUN_TEST(test_bin_get_output_names);
     RUN_TEST(test_bin_get_output_names_values);
+    RUN_TEST(test_bin_response_size);
 
     // PATCH request
     RUN_TEST(test_bin_patch_multiple_nodes);
@@ -451,12 +596,16 @@ void tests_binary_mode()
 
     // pub/sub messages
     RUN_TEST(test_bin_pub);
+    RUN_TEST(test_bin_pub_streamed);
+    RUN_TEST(test_bin_get_streamed);
     RUN_TEST(test_bin_pub_can);
     RUN_TEST(test_bin_sub);
 
     // general tests
     RUN_TEST(test_bin_num_elem);
     RUN_TEST(test_bin_serialize_long_string);
+    RUN_TEST(test_bin_serialize_string_exact_fit);
+    RUN_TEST(test_bin_serialize_arrays);
 
     // binary (bytes) data type
     RUN_TEST(test_bin_serialize_bytes);
@@ -17,6 +17,8 @@
 extern uint8_t req_buf[];
 extern uint8_t resp_buf[];
 extern ThingSet ts;
+extern ThingSet ts_const_index;
+extern ThingSet ts_stale_index;
 
 int hex2bin(char *const hex, uint8_t *bin, size_t bin_size)
 {
@@ -296,8 +298,8 @@ void bin_patch_txt_fetch()
     // float
     _cbor2json("f32", "12.34",  0x6007, "fa 41 45 70 a4");
     _cbor2json("f32", "-12.34", 0x6007, "fa c1 45 70 a4");
-    _cbor2json("f32", "12.34",  0x6007, "fa 41 45 81 06");      // 12.344
-    _cbor2json("f32", "12.35",  0x6007, "fa 41 45 85 1f");      // 12.345 (should be rounded to 12.35)
+    _cbor2json("f32", JSON_FLOAT("12.34", "12.344"), 0x6007, "fa 41 45 81 06");      // 12.344
+    _cbor2json("f32", JSON_FLOAT("12.35", "12.345"), 0x6007, "fa 41 45 85 1f");      // 12.345 (should be rounded to 12.35)
 
     // bool
     _cbor2json("bool", "true",  0x6008, "f5");
@@ -308,10 +310,199 @@ void bin_patch_txt_fetch()
     _cbor2json("strbuf", "\"Hello World!\"",  0x6009, "6c 48 65 6c 6c 6f 20 57 6f 72 6c 64 21");
 }
 
+void test_get_node_by_id()
+{
+    const DataNode *node;
+
+    node = ts.get_node(ID_INFO);        // first node in the array
+    TEST_ASSERT_NOT_NULL(node);
+    TEST_ASSERT_EQUAL_STRING("info", node->name);
+
+    node = ts.get_node(0x8000);         // last node in the array, highest ID
+    TEST_ASSERT_NOT_NULL(node);
+    TEST_ASSERT_EQUAL_STRING("bytesbuf", node->name);
+
+    node = ts.get_node(0x5001);         // not sorted by ID in the array
+    TEST_ASSERT_NOT_NULL(node);
+    TEST_ASSERT_EQUAL_STRING("dummy", node->name);
+
+    TEST_ASSERT_NULL(ts.get_node(0x00));
+    TEST_ASSERT_NULL(ts.get_node(0x17));
+    TEST_ASSERT_NULL(ts.get_node(0x6000));
+    TEST_ASSERT_NULL(ts.get_node(0xFFFF));
+}
+
+void test_get_node_by_name()
+{
+    const DataNode *node;
+
+    node = ts.get_node("Bat_V", strlen("Bat_V"), ID_OUTPUT);
+    TEST_ASSERT_NOT_NULL(node);
+    TEST_ASSERT_EQUAL(0x71, node->id);
+
+    // same name below different parents
+    node = ts.get_node("Enable", strlen("Enable"), 0xF5);
+    TEST_ASSERT_NOT_NULL(node);
+    TEST_ASSERT_EQUAL(0xF6, node->id);
+
+    // global search returns first match in data_nodes array
+    node = ts.get_node("Enable", strlen("Enable"));
+    TEST_ASSERT_NOT_NULL(node);
+    TEST_ASSERT_EQUAL(0xF2, node->id);
+
+    // children of root node
+    node = ts.get_node("conf", strlen("conf"), 0);
+    TEST_ASSERT_NOT_NULL(node);
+    TEST_ASSERT_EQUAL(ID_CONF, node->id);
+
+    // name must match entirely (i32 vs. i32_readonly)
+    node = ts.get_node("i32_readonly", strlen("i32"), 0x1000);
+    TEST_ASSERT_NULL(node);
+    node = ts.get_node("i3", strlen("i3"), ID_CONF);
+    TEST_ASSERT_NULL(node);
+
+    // wrong parent
+    node = ts.get_node("Bat_V", strlen("Bat_V"), ID_CONF);
+    TEST_ASSERT_NULL(node);
+    node = ts.get_node("Bat_V", strlen("Bat_V"), 0x1234);
+    TEST_ASSERT_NULL(node);
+}
+
+void test_const_node_index()
+{
+    for (unsigned int id = 0; id <= 0xFFFF; id++) {
+        TEST_ASSERT_EQUAL(ts.get_node(id), ts_const_index.get_node(id));
+    }
+
+    const char *names[] = { "info", "Bat_V", "Enable", "IDs", "i32", "bytesbuf", "foo" };
+    for (unsigned int i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        const DataNode *node = ts.get_node(names[i], strlen(names[i]));
+        TEST_ASSERT_EQUAL(node, ts_const_index.get_node(names[i], strlen(names[i])));
+        if (node) {
+            TEST_ASSERT_EQUAL(node, ts_const_index.get_node(names[i], strlen(names[i]),
+                node->parent));
+        }
+    }
+
+    const char *path = "pub/can/Interval_ms";
+    TEST_ASSERT_EQUAL(ts.get_endpoint(path, strlen(path)),
+        ts_const_index.get_endpoint(path, strlen(path)));
+
+    // outdated tables are replaced by tables built at runtime
+    for (unsigned int id = 0; id <= 0xFFFF; id++) {
+        TEST_ASSERT_EQUAL(ts.get_node(id), ts_stale_index.get_node(id));
+    }
+    TEST_ASSERT_EQUAL_HEX(TS_STATUS_VALID, ts_stale_index.get_status());
+}
+
+void test_const_node_index_array_len()
+{
+    static node_id_t ids[5] = { 0x10, 0x20 };
+    static ArrayInfo ids_array = { ids, 5, TS_AUTODETECT_ARRLEN, TS_T_NODE_ID };
+    DataNode array_nodes[] = {
+        TS_NODE_PATH(0x10, "conf", 0, NULL),
+        TS_NODE_ARRAY(0x20, "ids", &ids_array, 0, 0x10, TS_ANY_R, 0),
+    };
+
+    // outdated tables, so that the constructor falls back to building them at runtime
+    const TsNodeIndex outdated_index = { 0, 0, NULL, NULL, NULL, NULL };
+    ThingSet ts_arr(array_nodes, sizeof(array_nodes)/sizeof(DataNode), outdated_index);
+    TEST_ASSERT_EQUAL_HEX(TS_STATUS_VALID, ts_arr.get_status());
+    TEST_ASSERT_EQUAL(2, ids_array.num_elements);
+
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?conf/ids");
+    ts_arr.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL_STRING(":85 Content. [\"conf\",\"ids\"]", resp_buf);
+}
+
+void test_duplicate_node_ids()
+{
+    TEST_ASSERT_EQUAL_HEX(TS_STATUS_VALID, ts.get_status());
+    TEST_ASSERT_EQUAL_HEX(TS_STATUS_VALID, ts_const_index.get_status());
+
+    DataNode dup_nodes[] = {
+        TS_NODE_PATH(0x10, "a", 0, NULL),
+        TS_NODE_PATH(0x20, "b", 0, NULL),
+        TS_NODE_PATH(0x30, "c", 0x20, NULL),
+        TS_NODE_PATH(0x20, "d", 0x10, NULL),
+    };
+    ThingSet ts_dup(dup_nodes, sizeof(dup_nodes)/sizeof(DataNode));
+    TEST_ASSERT_EQUAL_HEX(TS_STATUS_CONFLICT, ts_dup.get_status());
+    TEST_ASSERT_EQUAL_HEX(0x20, ts_dup.get_conflicting_id());
+}
+
+void test_node_ids_not_checked()
+{
+#if !TS_32BIT_NODE_IDS
+    // positions of more than 65535 nodes can't be stored in the lookup tables
+    size_t num = 0x10001;
+    DataNode *many_nodes = (DataNode *)calloc(num, sizeof(DataNode));
+    TEST_ASSERT_NOT_NULL(many_nodes);
+    for (size_t i = 0; i < num; i++) {
+        many_nodes[i].name = "";
+    }
+    {
+        ThingSet ts_many(many_nodes, num);
+        TEST_ASSERT_EQUAL_HEX(TS_STATUS_NOT_IMPLEMENTED, ts_many.get_status());
+        TEST_ASSERT_EQUAL_HEX(0, ts_many.get_conflicting_id());
+    }
+    free(many_nodes);
+#endif
+}
+
+#if TS_32BIT_NODE_IDS
+#define DEVICE_ID(dev, id)  (((node_id_t)(dev) << 16) | (id))
+#else
+#define DEVICE_ID(dev, id)  (((node_id_t)(dev) << 8) | (id))
+#endif
+
+void test_sparse_node_ids()
+{
+    static float dev1_voltage = 12.5;
+    static float dev2_voltage = 24.5;
+    DataNode sparse_nodes[] = {
+        TS_NODE_PATH(DEVICE_ID(2, 0), "dev2", 0, NULL),
+        TS_NODE_FLOAT(DEVICE_ID(2, 1), "Bat_V", &dev2_voltage, 1, DEVICE_ID(2, 0), TS_ANY_R, 0),
+        TS_NODE_PATH(DEVICE_ID(1, 0), "dev1", 0, NULL),
+        TS_NODE_FLOAT(DEVICE_ID(1, 1), "Bat_V", &dev1_voltage, 1, DEVICE_ID(1, 0), TS_ANY_R, 0),
+    };
+    ThingSet ts_sparse(sparse_nodes, sizeof(sparse_nodes)/sizeof(DataNode));
+    TEST_ASSERT_EQUAL_HEX(TS_STATUS_VALID, ts_sparse.get_status());
+
+    for (unsigned int i = 0; i < sizeof(sparse_nodes)/sizeof(DataNode); i++) {
+        TEST_ASSERT_EQUAL_PTR(&sparse_nodes[i], ts_sparse.get_node(sparse_nodes[i].id));
+    }
+    TEST_ASSERT_NULL(ts_sparse.get_node(DEVICE_ID(1, 2)));
+    TEST_ASSERT_NULL(ts_sparse.get_node(DEVICE_ID(3, 0)));
+
+    const char path[] = "dev1/Bat_V";
+    TEST_ASSERT_EQUAL_PTR(&sparse_nodes[3], ts_sparse.get_endpoint(path, strlen(path)));
+
+    // binary mode request with shortest CBOR encoding of the ID
+    int len = 0;
+    req_buf[len++] = TS_FETCH;
+    len += cbor_serialize_uint(&req_buf[len], DEVICE_ID(1, 0), 10);
+    len += cbor_serialize_uint(&req_buf[len], DEVICE_ID(1, 1), 10);
+    int resp_len = ts_sparse.process(req_buf, len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL_HEX(TS_STATUS_CONTENT, resp_buf[0]);
+    float value;
+    TEST_ASSERT_EQUAL(resp_len - 1, cbor_deserialize_float(&resp_buf[1], &value));
+    TEST_ASSERT_EQUAL_FLOAT(12.5, value);
+}
+
 void tests_common()
 {
     UNITY_BEGIN();
 
+    // node lookup
+    RUN_TEST(test_get_node_by_id);
+    RUN_TEST(test_get_node_by_name);
+    RUN_TEST(test_const_node_index);
+    RUN_TEST(test_const_node_index_array_len);
+    RUN_TEST(test_duplicate_node_ids);
+    RUN_TEST(test_node_ids_not_checked);
+    RUN_TEST(test_sparse_node_ids);
+
     // data conversion tests
     RUN_TEST(txt_patch_bin_fetch);
     RUN_TEST(bin_patch_txt_fetch);
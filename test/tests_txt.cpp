@@ -8,10 +8,12 @@
 #include "unity.h"
 
 #include "thingset.h"
+#include "json.h"
 
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
 
 extern uint8_t req_buf[];
 extern uint8_t resp_buf[];
@@ -19,6 +21,7 @@ extern ThingSet ts;
 
 extern float f32;
 extern int32_t i32;
+extern char strbuf[];
 extern ArrayInfo int32_array;
 extern ArrayInfo float32_array;
 extern bool b;
@@ -39,7 +42,16 @@ void test_txt_get_output_names_values()
     size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?output");
     int resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
     TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
-    TEST_ASSERT_EQUAL_STRING(":85 Content. {\"Bat_V\":14.10,\"Bat_A\":5.13,\"Ambient_degC\":22}", resp_buf);
+    TEST_ASSERT_EQUAL_STRING(":85 Content. {\"Bat_V\":" JSON_FLOAT("14.10", "14.1")
+        ",\"Bat_A\":5.13,\"Ambient_degC\":22}", resp_buf);
+}
+
+void test_txt_get_readable_names_only()
+{
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?test/");
+    int resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":85 Content. [\"i32_readonly\"]", resp_buf);
 }
 
 void test_txt_fetch_array()
@@ -51,7 +63,7 @@ void test_txt_fetch_array()
     size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?conf [\"f32\",\"bool\",\"i32\"]");
     int resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
     TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
-    TEST_ASSERT_EQUAL_STRING(":85 Content. [52.80,false,50]", resp_buf);
+    TEST_ASSERT_EQUAL_STRING(":85 Content. [" JSON_FLOAT("52.80", "52.8") ",false,50]", resp_buf);
 }
 
 void test_txt_fetch_rounded()
@@ -59,7 +71,29 @@ void test_txt_fetch_rounded()
     size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?conf \"f32_rounded\"");
     int resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
     TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
-    TEST_ASSERT_EQUAL_STRING(":85 Content. 53", resp_buf);
+    TEST_ASSERT_EQUAL_STRING(":85 Content. " JSON_FLOAT("53", "52.8"), resp_buf);
+}
+
+static float shortest_f32 = 14.4F;
+static float shortest_floats[] = { 0.1F, 1e-7F, 3.4028235e38F };
+static ArrayInfo shortest_array = { shortest_floats, 3, 3, TS_T_FLOAT32 };
+
+static DataNode shortest_nodes[] = {
+    TS_NODE_PATH(0x01, "conf", 0, NULL),
+    TS_NODE_FLOAT(0x02, "f32", &shortest_f32, TS_FLOAT_SHORTEST, 0x01, TS_ANY_RW, 0),
+    TS_NODE_ARRAY(0x03, "arr", &shortest_array, TS_FLOAT_SHORTEST, 0x01, TS_ANY_RW, 0),
+};
+
+void test_txt_fetch_shortest_float()
+{
+    ThingSet ts_shortest(shortest_nodes, sizeof(shortest_nodes)/sizeof(DataNode));
+    ts_shortest.set_json_tokens(json_tokens, TEST_NUM_JSON_TOKENS);
+
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?conf [\"f32\",\"arr\"]");
+    int resp_len = ts_shortest.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":85 Content. [14.4,[0.1,1e-7,3.4028235e38]]", resp_buf);
+    TEST_ASSERT_EQUAL(resp_len, ts_shortest.process_size(req_buf, req_len));
 }
 
 void test_txt_fetch_nan()
@@ -149,6 +183,36 @@ void test_txt_patch_unknown_node()
     TEST_ASSERT_EQUAL_STRING(":A4 Not Found.", resp_buf);
 }
 
+void test_txt_patch_all_or_nothing()
+{
+    f32 = 1.5F;
+    b = false;
+    strcpy(strbuf, "before");
+
+    // valid values must not be written if another element of the request is invalid
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN,
+        "=conf {\"f32\":52.8,\"strbuf\":\"after\",\"bool\":\"wrong\"}");
+    int resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(":AF Unsupported Content-Format.", resp_buf);
+    TEST_ASSERT_EQUAL_FLOAT(1.5, f32);
+    TEST_ASSERT_EQUAL_STRING("before", strbuf);
+
+    // value out of range for the type of the node
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "=conf {\"f32\":52.8,\"i16\":32768}");
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL_STRING(":AF Unsupported Content-Format.", resp_buf);
+    TEST_ASSERT_EQUAL_FLOAT(1.5, f32);
+
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN,
+        "=conf {\"f32\":52.8,\"strbuf\":\"after\",\"bool\":true}");
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL_STRING(":84 Changed.", resp_buf);
+    TEST_ASSERT_EQUAL_FLOAT(52.8, f32);
+    TEST_ASSERT_EQUAL_STRING("after", strbuf);
+    TEST_ASSERT(b);
+}
+
 bool conf_callback_called;
 
 void conf_callback(void)        // implement function as defined in test_data.h
@@ -190,10 +254,355 @@ void test_txt_pub_msg()
     int resp_len = ts.txt_pub((char *)resp_buf, TS_RESP_BUFFER_LEN, PUB_SER);
     TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
     TEST_ASSERT_EQUAL_STRING(
-        "# {\"Timestamp_s\":12345678,\"Bat_V\":14.10,\"Bat_A\":5.13,\"Ambient_degC\":22}",
+        "# {\"Timestamp_s\":12345678,\"Bat_V\":" JSON_FLOAT("14.10", "14.1")
+        ",\"Bat_A\":5.13,\"Ambient_degC\":22}",
         resp_buf);
 }
 
+void test_txt_pub_delta()
+{
+    char msg[100];
+    float *bat_v = (float *)ts.get_node(0x71)->data;
+    float *bat_a = (float *)ts.get_node(0x72)->data;
+    TEST_ASSERT(ts.enable_pub_delta(PUB_SER, 3));
+
+    // all nodes in first message
+    TEST_ASSERT_EQUAL(strlen("# {\"Timestamp_s\":12345678,\"Bat_V\":" JSON_FLOAT("14.10", "14.1")
+        ",\"Bat_A\":5.13,"
+        "\"Ambient_degC\":22}"), ts.txt_pub(msg, sizeof(msg), PUB_SER));
+
+    // no message without changes
+    TEST_ASSERT_EQUAL(0, ts.txt_pub_size(PUB_SER));
+    TEST_ASSERT_EQUAL(0, ts.txt_pub(msg, sizeof(msg), PUB_SER));
+
+    *bat_v = 14.2F;
+    int len = ts.txt_pub_size(PUB_SER);
+    TEST_ASSERT_EQUAL(len, ts.txt_pub(msg, sizeof(msg), PUB_SER));
+    TEST_ASSERT_EQUAL_STRING("# {\"Bat_V\":" JSON_FLOAT("14.20", "14.2") "}", msg);
+
+    // every 3rd message contains all nodes
+    len = ts.txt_pub(msg, sizeof(msg), PUB_SER);
+    TEST_ASSERT_EQUAL_STRING("# {\"Timestamp_s\":12345678,\"Bat_V\":" JSON_FLOAT("14.20", "14.2")
+        ",\"Bat_A\":5.13,"
+        "\"Ambient_degC\":22}", msg);
+
+    // failed message is repeated completely
+    *bat_a = 6.13F;
+    TEST_ASSERT_EQUAL(0, ts.txt_pub(msg, 10, PUB_SER));
+    TEST_ASSERT_EQUAL(len, ts.txt_pub(msg, sizeof(msg), PUB_SER));
+
+    ts.request_full_pub(PUB_SER);
+    TEST_ASSERT_EQUAL(len, ts.txt_pub(msg, sizeof(msg), PUB_SER));
+
+    // binary mode uses the same delta state
+    *bat_a = 5.13F;
+    TEST_ASSERT_EQUAL(ts.bin_pub_size(PUB_SER), ts.bin_pub((uint8_t *)msg, sizeof(msg), PUB_SER));
+    TEST_ASSERT_EQUAL_HEX8(0xA1, msg[1]);    // map with 1 element
+    TEST_ASSERT_EQUAL_HEX8(0x18, msg[2]);
+    TEST_ASSERT_EQUAL_HEX8(0x72, msg[3]);    // Bat_A
+
+    // all nodes after the nodes of the channel were changed directly by the application (the
+    // added node has the same value as the removed one, so the snapshots would match)
+    DataNode *ambient = ts.get_node(0x73);
+    DataNode *ui32 = ts.get_node(0x6003);
+    uint32_t ui32_prev = *((uint32_t *)ui32->data);
+    *((uint32_t *)ui32->data) = 22;
+    TEST_ASSERT(ts.enable_pub_delta(PUB_SER, 0));
+    TEST_ASSERT(ts.txt_pub(msg, sizeof(msg), PUB_SER) > 0);
+    ambient->pubsub &= ~PUB_SER;
+    ui32->pubsub |= PUB_SER;
+    ts.update_pub_index();
+    TEST_ASSERT(ts.txt_pub(msg, sizeof(msg), PUB_SER) > 0);
+    TEST_ASSERT_NULL(strstr(msg, "Ambient_degC"));
+    TEST_ASSERT_NOT_NULL(strstr(msg, "\"ui32\":22"));
+    TEST_ASSERT_EQUAL(0, ts.txt_pub(msg, sizeof(msg), PUB_SER));
+    ambient->pubsub |= PUB_SER;
+    ui32->pubsub &= ~PUB_SER;
+    ts.update_pub_index();
+    *((uint32_t *)ui32->data) = ui32_prev;
+
+    // all nodes in each message after disabling
+    ts.disable_pub_delta(PUB_SER);
+    TEST_ASSERT_EQUAL(len, ts.txt_pub(msg, sizeof(msg), PUB_SER));
+    *bat_v = 14.1F;
+}
+
+void test_txt_pub_template()
+{
+    char expected[100];
+    char msg[100];
+    DataNode *bat_v = ts.get_node(0x71);
+    int len = ts.txt_pub(expected, sizeof(expected), PUB_SER);
+    TEST_ASSERT(ts.enable_pub_template(PUB_SER));
+    TEST_ASSERT(!ts.enable_pub_template(PUB_SER | PUB_CAN));
+
+    TEST_ASSERT_EQUAL(len, ts.txt_pub(msg, sizeof(msg), PUB_SER));
+    TEST_ASSERT_EQUAL_STRING(expected, msg);
+
+    // values are formatted again in each message
+    *((float *)bat_v->data) = 14.2F;
+    len = ts.txt_pub(msg, sizeof(msg), PUB_SER);
+    TEST_ASSERT_EQUAL_STRING("# {\"Timestamp_s\":12345678,\"Bat_V\":" JSON_FLOAT("14.20", "14.2")
+        ",\"Bat_A\":5.13,"
+        "\"Ambient_degC\":22}", msg);
+    TEST_ASSERT_EQUAL(ts.txt_pub_size(PUB_SER), len);
+    *((float *)bat_v->data) = 14.1F;
+
+    // buffer too small
+    TEST_ASSERT_EQUAL(0, ts.txt_pub(msg, 10, PUB_SER));
+    TEST_ASSERT_EQUAL(0, ts.txt_pub(msg, len, PUB_SER));
+
+    // template is rendered again after changing the nodes of the channel
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "-pub/serial/IDs \"Bat_V\"");
+    ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    ts.txt_pub(msg, sizeof(msg), PUB_SER);
+    TEST_ASSERT_EQUAL_STRING("# {\"Timestamp_s\":12345678,\"Bat_A\":5.13,\"Ambient_degC\":22}",
+        msg);
+
+    // flags changed directly by the application
+    bat_v->pubsub |= PUB_SER;
+    ts.update_pub_index();
+    ts.txt_pub(msg, sizeof(msg), PUB_SER);
+    TEST_ASSERT_EQUAL_STRING(expected, msg);
+
+    ts.disable_pub_template(PUB_SER);
+    TEST_ASSERT_EQUAL(strlen(expected), ts.txt_pub(msg, sizeof(msg), PUB_SER));
+    TEST_ASSERT_EQUAL_STRING(expected, msg);
+}
+
+struct StreamTestCtx {
+    char data[500];
+    size_t len;
+    size_t max_chunk;
+    int num_chunks;
+};
+
+static int stream_test_sink(const uint8_t *data, size_t len, void *ctx)
+{
+    StreamTestCtx *c = (StreamTestCtx *)ctx;
+    if (c->len + len >= sizeof(c->data)) {
+        return -1;
+    }
+    memcpy(&c->data[c->len], data, len);
+    c->len += len;
+    c->data[c->len] = '\0';
+    c->max_chunk = (len > c->max_chunk) ? len : c->max_chunk;
+    c->num_chunks++;
+    return 0;
+}
+
+void test_txt_pub_msg_streamed()
+{
+    char buf[24];
+    StreamTestCtx ctx = {};
+
+    // message is too long for the small buffer
+    TEST_ASSERT_EQUAL(0, ts.txt_pub(buf, sizeof(buf), PUB_SER));
+
+    int total = ts.txt_pub(buf, sizeof(buf), PUB_SER, stream_test_sink, &ctx);
+    int resp_len = ts.txt_pub((char *)resp_buf, TS_RESP_BUFFER_LEN, PUB_SER);
+    TEST_ASSERT_EQUAL(resp_len, total);
+    TEST_ASSERT_EQUAL(resp_len, ctx.len);
+    TEST_ASSERT_EQUAL_STRING((char *)resp_buf, ctx.data);
+    TEST_ASSERT(ctx.num_chunks > 1);
+    TEST_ASSERT(ctx.max_chunk < sizeof(buf));
+}
+
+void test_txt_get_streamed()
+{
+    uint8_t buf[20];
+    StreamTestCtx ctx = {};
+
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?output");
+    int total = ts.process(req_buf, req_len, buf, sizeof(buf), stream_test_sink, &ctx);
+    TEST_ASSERT_EQUAL(strlen(ctx.data), total);
+    TEST_ASSERT_EQUAL_STRING(":85 Content. {\"Bat_V\":" JSON_FLOAT("14.10", "14.1")
+        ",\"Bat_A\":5.13,\"Ambient_degC\":22}",
+        ctx.data);
+    TEST_ASSERT(ctx.max_chunk < sizeof(buf));
+
+    ctx = {};
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?output/");
+    total = ts.process(req_buf, req_len, buf, sizeof(buf), stream_test_sink, &ctx);
+    TEST_ASSERT_EQUAL(strlen(ctx.data), total);
+    TEST_ASSERT_EQUAL_STRING(":85 Content. [\"Bat_V\",\"Bat_A\",\"Ambient_degC\"]", ctx.data);
+
+    ctx = {};
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?output [\"Bat_V\",\"Ambient_degC\"]");
+    total = ts.process(req_buf, req_len, buf, sizeof(buf), stream_test_sink, &ctx);
+    TEST_ASSERT_EQUAL(strlen(ctx.data), total);
+    TEST_ASSERT_EQUAL_STRING(":85 Content. [" JSON_FLOAT("14.10", "14.1") ",22]", ctx.data);
+}
+
+static int iov_concat(const TsIoVec *iov, int count, char *buf, size_t size)
+{
+    size_t len = 0;
+    for (int i = 0; i < count; i++) {
+        if (len + iov[i].len >= size) {
+            return -1;
+        }
+        memcpy(&buf[len], iov[i].base, iov[i].len);
+        len += iov[i].len;
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+struct PubInSinkCtx {
+    StreamTestCtx stream;
+    char expected[300];
+    bool pub_ok;
+};
+
+static int pub_in_sink(const uint8_t *data, size_t len, void *ctx)
+{
+    PubInSinkCtx *c = (PubInSinkCtx *)ctx;
+    char buf[24];
+    StreamTestCtx pub_ctx = {};
+    // e.g. a publication thread streaming a message while a response is streamed
+    int msg_len = ts.txt_pub(buf, sizeof(buf), PUB_SER, stream_test_sink, &pub_ctx);
+    c->pub_ok = c->pub_ok && msg_len > 0 && strcmp(pub_ctx.data, c->expected) == 0;
+
+    TsIoVec iov[20];
+    char scratch[120];
+    char msg[300];
+    int count = ts.txt_pub(iov, 20, scratch, sizeof(scratch), PUB_SER);
+    c->pub_ok = c->pub_ok && iov_concat(iov, count, msg, sizeof(msg)) > 0 &&
+        strcmp(msg, c->expected) == 0;
+
+    c->pub_ok = c->pub_ok && ts.txt_pub_size(PUB_SER) == (int)strlen(c->expected);
+    return stream_test_sink(data, len, &c->stream);
+}
+
+void test_txt_pub_during_streamed_get()
+{
+    uint8_t buf[20];
+    PubInSinkCtx ctx = {};
+    ctx.pub_ok = true;
+    ts.txt_pub(ctx.expected, sizeof(ctx.expected), PUB_SER);
+
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?output");
+    int total = ts.process(req_buf, req_len, buf, sizeof(buf), pub_in_sink, &ctx);
+    TEST_ASSERT_EQUAL(strlen(ctx.stream.data), total);
+    TEST_ASSERT_EQUAL_STRING(":85 Content. {\"Bat_V\":" JSON_FLOAT("14.10", "14.1")
+        ",\"Bat_A\":5.13,\"Ambient_degC\":22}",
+        ctx.stream.data);
+    TEST_ASSERT(ctx.stream.num_chunks > 1);
+    TEST_ASSERT(ctx.pub_ok);
+}
+
+void test_txt_get_streamed_sink_failure()
+{
+    uint8_t buf[20];
+    StreamTestCtx ctx = {};
+    ctx.len = sizeof(ctx.data) - 20;    // sink fails after first chunk
+
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?output");
+    TEST_ASSERT_EQUAL(0, ts.process(req_buf, req_len, buf, sizeof(buf), stream_test_sink, &ctx));
+
+    // normal processing is not affected afterwards
+    int resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+}
+
+/*
+ * Number of fragments referencing the name of a node
+ */
+static int iov_name_refs(const TsIoVec *iov, int count, const DataNode *node)
+{
+    int refs = 0;
+    for (int i = 0; i < count; i++) {
+        if (iov[i].base == node->name) {
+            TEST_ASSERT_EQUAL(strlen(node->name), iov[i].len);
+            refs++;
+        }
+    }
+    return refs;
+}
+
+void test_txt_get_iov()
+{
+    TsIoVec iov[10];
+    char scratch[120];
+    char msg[200];
+    node_id_t output_ids[] = { 0x71, 0x72, 0x73 };     // Bat_V, Bat_A, Ambient_degC
+
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?output");
+    int count = ts.process(req_buf, req_len, iov, 10, (uint8_t *)scratch, sizeof(scratch));
+    TEST_ASSERT(count > 0);
+    iov_concat(iov, count, msg, sizeof(msg));
+    TEST_ASSERT_EQUAL_STRING(":85 Content. {\"Bat_V\":" JSON_FLOAT("14.10", "14.1")
+        ",\"Bat_A\":5.13,\"Ambient_degC\":22}", msg);
+
+    // long node names are referenced, short ones copied
+    int expected_count = 1;
+    for (unsigned int i = 0; i < sizeof(output_ids) / sizeof(output_ids[0]); i++) {
+        DataNode *node = ts.get_node(output_ids[i]);
+        int refs = (strlen(node->name) >= TS_IOV_MIN_NAME_LEN) ? 1 : 0;
+        TEST_ASSERT_EQUAL(refs, iov_name_refs(iov, count, node));
+        expected_count += 2 * refs;
+    }
+    TEST_ASSERT_EQUAL(expected_count, count);
+
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?output/");
+    count = ts.process(req_buf, req_len, iov, 10, (uint8_t *)scratch, sizeof(scratch));
+    TEST_ASSERT_EQUAL(expected_count, count);
+    iov_concat(iov, count, msg, sizeof(msg));
+    TEST_ASSERT_EQUAL_STRING(":85 Content. [\"Bat_V\",\"Bat_A\",\"Ambient_degC\"]", msg);
+
+    if (expected_count > 2) {
+        // not enough fragments for the names
+        count = ts.process(req_buf, req_len, iov, expected_count - 2, (uint8_t *)scratch,
+            sizeof(scratch));
+        TEST_ASSERT_EQUAL(1, count);
+        TEST_ASSERT_EQUAL_HEX8(TS_STATUS_RESPONSE_TOO_LARGE, strtoul(scratch + 1, NULL, 16));
+    }
+
+    // other responses are stored in a single fragment
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?output [\"Bat_V\"]");
+    count = ts.process(req_buf, req_len, iov, 10, (uint8_t *)scratch, sizeof(scratch));
+    TEST_ASSERT_EQUAL(1, count);
+    TEST_ASSERT_EQUAL_PTR(scratch, iov[0].base);
+    TEST_ASSERT_EQUAL_STRING(":85 Content. [" JSON_FLOAT("14.10", "14.1") "]", scratch);
+}
+
+void test_txt_pub_msg_iov()
+{
+    TsIoVec iov[20];
+    char scratch[120];
+    char msg[200];
+
+    int count = ts.txt_pub(iov, 20, scratch, sizeof(scratch), PUB_SER);
+    TEST_ASSERT(count > 0);
+    int len = iov_concat(iov, count, msg, sizeof(msg));
+    int resp_len = ts.txt_pub((char *)resp_buf, TS_RESP_BUFFER_LEN, PUB_SER);
+    TEST_ASSERT_EQUAL(resp_len, len);
+    TEST_ASSERT_EQUAL_STRING((char *)resp_buf, msg);
+}
+
+void test_txt_response_size()
+{
+    const char *requests[] = {
+        "?output", "?output/", "?conf", "?info", "?pub/serial", "?pub/serial/IDs", "?/",
+        "?output [\"Bat_V\",\"Ambient_degC\"]", "?output \"Bat_V\"", "?conf/arrayfloat",
+        "?unknown", "?output [\"Unknown\"]", "?test", "?exec", "?input", "?pub/can"
+    };
+
+    for (unsigned int i = 0; i < sizeof(requests) / sizeof(requests[0]); i++) {
+        size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "%s", requests[i]);
+        int size = ts.process_size(req_buf, req_len);
+        int resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+        TEST_ASSERT_EQUAL(resp_len, size);
+    }
+
+    // requests with side effects can't be measured
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "!exec/dummy");
+    TEST_ASSERT_EQUAL(0, ts.process_size(req_buf, req_len));
+
+    TEST_ASSERT_EQUAL(ts.txt_pub((char *)resp_buf, TS_RESP_BUFFER_LEN, PUB_SER),
+        ts.txt_pub_size(PUB_SER));
+}
+
 void test_txt_pub_list_channels()
 {
     size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?pub/");
@@ -248,6 +657,43 @@ void test_txt_pub_delete_append_node()
         ":85 Content. [\"Timestamp_s\",\"Bat_V\",\"Bat_A\",\"Ambient_degC\"]", resp_buf);
 }
 
+void test_txt_pub_msg_after_delete_append()
+{
+    const char pub_all[] =
+        "# {\"Timestamp_s\":12345678,\"Bat_V\":" JSON_FLOAT("14.10", "14.1")
+        ",\"Bat_A\":5.13,\"Ambient_degC\":22}";
+
+    // remove node from the middle of the channel
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "-pub/serial/IDs \"Bat_V\"");
+    int resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL_STRING(":82 Deleted.", resp_buf);
+
+    resp_len = ts.txt_pub((char *)resp_buf, TS_RESP_BUFFER_LEN, PUB_SER);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(
+        "# {\"Timestamp_s\":12345678,\"Bat_A\":5.13,\"Ambient_degC\":22}", resp_buf);
+
+    // other channels must not be affected
+    resp_len = ts.txt_pub((char *)resp_buf, TS_RESP_BUFFER_LEN, PUB_CAN);
+    TEST_ASSERT_EQUAL_STRING("# {\"Bat_V\":" JSON_FLOAT("14.10", "14.1")
+        ",\"Bat_A\":5.13}", resp_buf);
+
+    // appended node is published at its original position
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "+pub/serial/IDs \"Bat_V\"");
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL_STRING(":81 Created.", resp_buf);
+
+    resp_len = ts.txt_pub((char *)resp_buf, TS_RESP_BUFFER_LEN, PUB_SER);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(pub_all, resp_buf);
+
+    // appending a node twice must not publish it twice
+    req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "+pub/serial/IDs \"Bat_V\"");
+    resp_len = ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    resp_len = ts.txt_pub((char *)resp_buf, TS_RESP_BUFFER_LEN, PUB_SER);
+    TEST_ASSERT_EQUAL_STRING(pub_all, resp_buf);
+}
+
 void test_txt_auth_user()
 {
     // authorize as expert user
@@ -329,6 +775,123 @@ void test_txt_auth_reset()
     TEST_ASSERT_EQUAL_STRING(":A1 Unauthorized.", resp_buf);
 }
 
+void test_txt_json_tokens()
+{
+    const char *fetch = "?conf [\"BatCharging_V\",\"LoadDisconnect_V\"]";
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "%s", fetch);
+    int num = ThingSet::count_json_tokens(req_buf, req_len);
+    TEST_ASSERT_EQUAL(3, num);
+    TEST_ASSERT_EQUAL(0, ThingSet::count_json_tokens((uint8_t *)"?conf", 5));
+
+    // provided buffer too small
+    jsmntok_t arena[3];
+    ts.set_json_tokens(arena, num - 1);
+    ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL_STRING(":AD Request Entity Too Large.", resp_buf);
+
+    // exactly sized buffer
+    ts.set_json_tokens(arena, num);
+    ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL_STRING(":85 Content. [" JSON_FLOAT("14.40", "14.4")
+        "," JSON_FLOAT("10.80", "10.8") "]", resp_buf);
+
+    // internal storage
+    ts.set_json_tokens(NULL, 0);
+    ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+#if TS_NUM_JSON_TOKENS > 0
+    TEST_ASSERT_EQUAL_STRING(":85 Content. [" JSON_FLOAT("14.40", "14.4")
+        "," JSON_FLOAT("10.80", "10.8") "]", resp_buf);
+#else
+    TEST_ASSERT_EQUAL_STRING(":AD Request Entity Too Large.", resp_buf);
+#endif
+
+    ts.set_json_tokens(json_tokens, TEST_NUM_JSON_TOKENS);
+}
+
+void test_txt_large_payload()
+{
+    // node name longer than 32 kB in a FETCH request
+    const size_t name_len = 40000;
+    uint8_t *req = (uint8_t *)malloc(name_len + 20);
+    size_t req_len = snprintf((char *)req, 20, "?conf [\"");
+    memset(&req[req_len], 'x', name_len);
+    req_len += name_len;
+    req_len += snprintf((char *)&req[req_len], 20, "\"]");
+
+    int resp_len = ts.process(req, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+#if TS_32BIT_JSON_OFFSETS
+    TEST_ASSERT_EQUAL(2, ThingSet::count_json_tokens(req, req_len));
+    TEST_ASSERT_EQUAL_STRING(":A4 Not Found.", resp_buf);
+#else
+    TEST_ASSERT_EQUAL(JSMN_ERROR_NOMEM, ThingSet::count_json_tokens(req, req_len));
+    TEST_ASSERT_EQUAL_STRING(":AD Request Entity Too Large.", resp_buf);
+#endif
+    free(req);
+}
+
+void test_txt_feed()
+{
+    const char *requests[] = {
+        "?output",
+        "?output/",
+        "?conf [\"BatCharging_V\",\"LoadDisconnect_V\"]",
+        "?conf {\"BatCharging_V\":1}",
+        "!exec/reset",
+        "?unknown",
+    };
+    uint8_t feed_buf[100];
+    char expected[TS_RESP_BUFFER_LEN];
+    size_t consumed;
+    ts.feed_init(feed_buf, sizeof(feed_buf));
+
+    for (unsigned int i = 0; i < sizeof(requests) / sizeof(requests[0]); i++) {
+        size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "%s", requests[i]);
+        int len = ts.process(req_buf, req_len, (uint8_t *)expected, sizeof(expected));
+
+        // one byte at a time, terminated with CR/LF
+        snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "%s\r\n", requests[i]);
+        for (size_t pos = 0; pos < req_len + 1; pos++) {
+            TEST_ASSERT_EQUAL(0, ts.feed(&req_buf[pos], 1, consumed, resp_buf,
+                TS_RESP_BUFFER_LEN));
+            TEST_ASSERT_EQUAL(1, consumed);
+        }
+        TEST_ASSERT_EQUAL(len, ts.feed(&req_buf[req_len + 1], 1, consumed, resp_buf,
+            TS_RESP_BUFFER_LEN));
+        TEST_ASSERT_EQUAL_STRING(expected, resp_buf);
+    }
+
+    // bytes after the newline are not consumed
+    const char two[] = "?output\n?output/\n";
+    TEST_ASSERT(ts.feed((uint8_t *)two, strlen(two), consumed, resp_buf, TS_RESP_BUFFER_LEN) > 0);
+    TEST_ASSERT_EQUAL(strlen("?output\n"), consumed);
+    size_t pos = consumed;
+    TEST_ASSERT(ts.feed((uint8_t *)two + pos, strlen(two) - pos, consumed, resp_buf,
+        TS_RESP_BUFFER_LEN) > 0);
+    TEST_ASSERT_EQUAL(strlen("?output/\n"), consumed);
+
+    // other request processed while the payload is received
+    const char *fetch = "?conf [\"BatCharging_V\"]\n";
+    ts.process((uint8_t *)expected, snprintf(expected, sizeof(expected), "%s", fetch) - 1,
+        resp_buf, TS_RESP_BUFFER_LEN);
+    strcpy(expected, (char *)resp_buf);
+    ts.feed((uint8_t *)fetch, 10, consumed, resp_buf, TS_RESP_BUFFER_LEN);
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?info [\"Manufacturer\"]");
+    ts.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    ts.feed((uint8_t *)fetch + 10, strlen(fetch) - 10, consumed, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL_STRING(expected, resp_buf);
+
+    // request too large for the buffer
+    ts.feed_init(feed_buf, 8);
+    const char *large = "?conf [\"BatCharging_V\"]\n";
+    ts.feed((uint8_t *)large, strlen(large), consumed, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL_STRING(":AD Request Entity Too Large.", resp_buf);
+
+    // other data is ignored
+    TEST_ASSERT_EQUAL(0, ts.feed((uint8_t *)"abc\n", 4, consumed, resp_buf,
+        TS_RESP_BUFFER_LEN));
+}
+
 void test_txt_wrong_command()
 {
     size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "!abcd \"f32\"");
@@ -363,6 +926,352 @@ void test_txt_get_endpoint()
     TEST_ASSERT_EQUAL(node->id, 0xE1);
 }
 
+static DataNode deep_nodes[] = {
+    TS_NODE_PATH(0x01, "l1", 0, NULL),
+    TS_NODE_PATH(0x02, "l2", 0x01, NULL),
+    TS_NODE_PATH(0x03, "l3", 0x02, NULL),
+    TS_NODE_PATH(0x04, "l4", 0x03, NULL),
+    TS_NODE_PATH(0x05, "l5", 0x04, NULL),
+    TS_NODE_PATH(0x06, "l6", 0x05, NULL),
+    TS_NODE_PATH(0x07, "l7", 0x06, NULL),
+    TS_NODE_PATH(0x08, "l8", 0x07, NULL),
+    TS_NODE_PATH(0x09, "l9", 0x08, NULL),
+    TS_NODE_PATH(0x0A, "l10", 0x09, NULL),
+    TS_NODE_PATH(0x0B, "l11", 0x0A, NULL),
+    TS_NODE_PATH(0x0C, "l12", 0x0B, NULL),
+    TS_NODE_PATH(0x0D, "l1", 0x0C, NULL),     // same name as top-level node
+};
+
+void test_txt_get_endpoint_deep_path()
+{
+    ThingSet ts_deep(deep_nodes, sizeof(deep_nodes)/sizeof(DataNode));
+    const char path[] = "l1/l2/l3/l4/l5/l6/l7/l8/l9/l10/l11/l12/l1";
+    const DataNode *node;
+
+    // resolve twice to use cached path in second run
+    for (int i = 0; i < 2; i++) {
+        node = ts_deep.get_endpoint(path, strlen(path));
+        TEST_ASSERT_NOT_NULL(node);
+        TEST_ASSERT_EQUAL(0x0D, node->id);
+
+        node = ts_deep.get_endpoint(path, strlen("l1/l2/l3/l4/l5/l6/l7/l8/l9/l10/l11/"));
+        TEST_ASSERT_NOT_NULL(node);
+        TEST_ASSERT_EQUAL(0x0B, node->id);
+
+        node = ts_deep.get_endpoint(path, strlen("l1"));
+        TEST_ASSERT_NOT_NULL(node);
+        TEST_ASSERT_EQUAL(0x01, node->id);
+    }
+
+    TEST_ASSERT_NULL(ts_deep.get_endpoint("l2", strlen("l2")));
+    TEST_ASSERT_NULL(ts_deep.get_endpoint("l1/l3", strlen("l1/l3")));
+    TEST_ASSERT_NULL(ts_deep.get_endpoint("/l1", strlen("/l1")));
+    TEST_ASSERT_NULL(ts_deep.get_endpoint("l1//l2", strlen("l1//l2")));
+
+    // path is not null-terminated and must not be read beyond its length
+    char buf[] = { 'l', '1', '/', 'l', '2' };
+    node = ts_deep.get_endpoint(buf, 3);
+    TEST_ASSERT_NOT_NULL(node);
+    TEST_ASSERT_EQUAL(0x01, node->id);
+}
+
+void test_json_serialize_numbers()
+{
+    char buf[50];
+
+    TEST_ASSERT_EQUAL(11, json_serialize_int32(buf, INT32_MIN, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("-2147483648", buf);
+    TEST_ASSERT_EQUAL(10, json_serialize_uint32(buf, UINT32_MAX, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("4294967295", buf);
+    TEST_ASSERT_EQUAL(1, json_serialize_uint32(buf, 0, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("0", buf);
+    TEST_ASSERT_EQUAL(20, json_serialize_int64(buf, -9223372036854775807LL - 1, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("-9223372036854775808", buf);
+    TEST_ASSERT_EQUAL(20, json_serialize_uint64(buf, UINT64_MAX, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("18446744073709551615", buf);
+
+    // same output as printf with %.*f (ties rounded to even)
+    json_serialize_float(buf, 14.1F, 2, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("14.10", buf);
+    json_serialize_float(buf, 2.5F, 0, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("2", buf);
+    json_serialize_float(buf, 0.125F, 2, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("0.12", buf);
+    json_serialize_float(buf, 0.375F, 2, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("0.38", buf);
+    json_serialize_float(buf, -0.001F, 2, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("-0.00", buf);
+    json_serialize_float(buf, 0.1F, 12, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("0.100000001490", buf);
+    json_serialize_float(buf, 1e20F, 1, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("100000002004087734272.0", buf);
+    json_serialize_float(buf, NAN, 2, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("null", buf);
+    json_serialize_float(buf, -INFINITY, 2, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("null", buf);
+
+    // shortest representation that is parsed back to the same value
+    json_serialize_float(buf, 14.4F, JSON_FLOAT_SHORTEST, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("14.4", buf);
+    json_serialize_float(buf, 100.0F, JSON_FLOAT_SHORTEST, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("100", buf);
+    json_serialize_float(buf, -0.0012F, JSON_FLOAT_SHORTEST, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("-0.0012", buf);
+    json_serialize_float(buf, 1e21F, JSON_FLOAT_SHORTEST, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("1e21", buf);
+    json_serialize_float(buf, 1.4e-45F, JSON_FLOAT_SHORTEST, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("1e-45", buf);
+    json_serialize_float(buf, 16777216.0F, JSON_FLOAT_SHORTEST, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("16777216", buf);
+    json_serialize_float(buf, 0.0F, JSON_FLOAT_SHORTEST, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("0", buf);
+    json_serialize_float(buf, NAN, JSON_FLOAT_SHORTEST, sizeof(buf));
+    TEST_ASSERT_EQUAL_STRING("null", buf);
+
+    // buffer too small for value and null termination
+    TEST_ASSERT_EQUAL(0, json_serialize_float(buf, 14.1F, 2, 5));
+    TEST_ASSERT_EQUAL(5, json_serialize_float(buf, 14.1F, 2, 6));
+}
+
+void test_json_serialize_arrays()
+{
+    char buf[100];
+    char ref[100];
+    int16_t i16[] = { 0, -1, 9, 10, -32768, 32767 };
+    float f32[] = { 1.005F, -0.5F, NAN, 1e6F };
+
+    TEST_ASSERT_EQUAL(24, json_serialize_array_int16(buf, i16, 6, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("[0,-1,9,10,-32768,32767]", buf);
+    TEST_ASSERT_EQUAL(24, json_serialize_array_int16(NULL, i16, 6, 0));
+
+    int32_t i32[] = { INT32_MIN, INT32_MAX, 0, 999999999, 1000000000 };
+    TEST_ASSERT_EQUAL(47, json_serialize_array_int32(buf, i32, 5, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("[-2147483648,2147483647,0,999999999,1000000000]", buf);
+
+    uint32_t u32[] = { UINT32_MAX, 99999, 100000 };
+    TEST_ASSERT_EQUAL(25, json_serialize_array_uint32(buf, u32, 3, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("[4294967295,99999,100000]", buf);
+
+    TEST_ASSERT_EQUAL(2, json_serialize_array_uint16(buf, NULL, 0, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("[]", buf);
+    TEST_ASSERT_EQUAL(2, json_serialize_array_uint16(NULL, NULL, 0, 0));
+
+    // same result as serializing each element separately
+    int len = 1;
+    strcpy(ref, "[");
+    for (unsigned int i = 0; i < sizeof(f32) / sizeof(f32[0]); i++) {
+        len += json_serialize_float(&ref[len], f32[i], 3, sizeof(ref) - len);
+        ref[len++] = ',';
+    }
+    strcpy(&ref[len - 1], "]");
+    TEST_ASSERT_EQUAL(len, json_serialize_array_float(buf, f32, 4, 3, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING(ref, buf);
+    TEST_ASSERT_EQUAL(len, json_serialize_array_float(NULL, f32, 4, 3, 0));
+
+    // exact bounds check close to the end of the buffer (including null termination)
+    for (int size = 0; size <= len; size++) {
+        TEST_ASSERT_EQUAL(0, json_serialize_array_float(buf, f32, 4, 3, size));
+    }
+    TEST_ASSERT_EQUAL(len, json_serialize_array_float(buf, f32, 4, 3, len + 1));
+    for (int size = 0; size <= 24; size++) {
+        TEST_ASSERT_EQUAL(0, json_serialize_array_int16(buf, i16, 6, size));
+    }
+    TEST_ASSERT_EQUAL(24, json_serialize_array_int16(buf, i16, 6, 25));
+    TEST_ASSERT_EQUAL_STRING("[0,-1,9,10,-32768,32767]", buf);
+}
+
+static int parse_float(const char *str, float *value)
+{
+    return json_deserialize_float(str, strlen(str), value);
+}
+
+void test_json_deserialize_numbers()
+{
+    uint64_t u;
+    int64_t i;
+    float f;
+
+    // no null termination needed
+    TEST_ASSERT_EQUAL(3, json_deserialize_uint64("123,", 3, UINT16_MAX, &u));
+    TEST_ASSERT_EQUAL(123, u);
+    TEST_ASSERT_EQUAL(5, json_deserialize_uint64("65535", 5, UINT16_MAX, &u));
+    TEST_ASSERT_EQUAL(0, json_deserialize_uint64("65536", 5, UINT16_MAX, &u));
+    TEST_ASSERT_EQUAL(20, json_deserialize_uint64("18446744073709551615", 20, UINT64_MAX, &u));
+    TEST_ASSERT(u == UINT64_MAX);
+    TEST_ASSERT_EQUAL(0, json_deserialize_uint64("18446744073709551616", 20, UINT64_MAX, &u));
+    TEST_ASSERT_EQUAL(0, json_deserialize_uint64("-1", 2, UINT32_MAX, &u));
+    TEST_ASSERT_EQUAL(4, json_deserialize_uint64("0x1A", 4, UINT32_MAX, &u));
+    TEST_ASSERT_EQUAL(26, u);
+    TEST_ASSERT_EQUAL(4, json_deserialize_uint64("50.6", 4, UINT32_MAX, &u));
+    TEST_ASSERT_EQUAL(50, u);
+    TEST_ASSERT_EQUAL(0, json_deserialize_uint64("12a", 3, UINT32_MAX, &u));
+    TEST_ASSERT_EQUAL(0, json_deserialize_uint64("", 0, UINT32_MAX, &u));
+
+    TEST_ASSERT_EQUAL(6, json_deserialize_int64("-32768", 6, INT16_MIN, INT16_MAX, &i));
+    TEST_ASSERT_EQUAL(-32768, i);
+    TEST_ASSERT_EQUAL(0, json_deserialize_int64("-32769", 6, INT16_MIN, INT16_MAX, &i));
+    TEST_ASSERT_EQUAL(0, json_deserialize_int64("32768", 5, INT16_MIN, INT16_MAX, &i));
+    TEST_ASSERT_EQUAL(20, json_deserialize_int64("-9223372036854775808", 20, INT64_MIN,
+        INT64_MAX, &i));
+    TEST_ASSERT(i == INT64_MIN);
+    TEST_ASSERT_EQUAL(0, json_deserialize_int64("-", 1, INT32_MIN, INT32_MAX, &i));
+
+    // differences to strtol(str, NULL, 0)
+    TEST_ASSERT_EQUAL(0, json_deserialize_int64("+1", 2, INT32_MIN, INT32_MAX, &i));
+    TEST_ASSERT_EQUAL(0, json_deserialize_uint64("+1", 2, UINT32_MAX, &u));
+    TEST_ASSERT_EQUAL(0, json_deserialize_int64(" 1", 2, INT32_MIN, INT32_MAX, &i));
+    TEST_ASSERT_EQUAL(3, json_deserialize_int64("027", 3, INT32_MIN, INT32_MAX, &i));
+    TEST_ASSERT_EQUAL(27, i);                           // decimal, not octal
+    TEST_ASSERT_EQUAL(0, json_deserialize_int64("1e3", 3, INT32_MIN, INT32_MAX, &i));
+    TEST_ASSERT_EQUAL(0, json_deserialize_uint64("1e3", 3, UINT32_MAX, &u));
+    TEST_ASSERT_EQUAL(5, json_deserialize_int64("-0x1A", 5, INT32_MIN, INT32_MAX, &i));
+    TEST_ASSERT_EQUAL(-26, i);
+
+    TEST_ASSERT_EQUAL(4, json_deserialize_float("14.4}", 4, &f));
+    TEST_ASSERT_EQUAL_FLOAT(14.4, f);
+    TEST_ASSERT(parse_float("-1.5e-3", &f) > 0);
+    TEST_ASSERT_EQUAL_FLOAT(-0.0015, f);
+    TEST_ASSERT(parse_float("3.4028235e38", &f) > 0);
+    TEST_ASSERT(f == 3.4028235e38F);
+    TEST_ASSERT(parse_float("1e-45", &f) > 0);
+    TEST_ASSERT(f == 1e-45F);
+    TEST_ASSERT(parse_float("1e-50", &f) > 0);
+    TEST_ASSERT(f == 0.0F);
+    TEST_ASSERT_EQUAL(0, parse_float("3.5e38", &f));
+    TEST_ASSERT_EQUAL(0, parse_float("1.2.3", &f));
+    TEST_ASSERT_EQUAL(0, parse_float("1e", &f));
+    TEST_ASSERT_EQUAL(0, parse_float("nan", &f));
+
+    // differences to strtod
+    TEST_ASSERT_EQUAL(0, parse_float("+1.5", &f));
+    TEST_ASSERT_EQUAL(0, parse_float("0x10", &f));
+    TEST_ASSERT_EQUAL(0, parse_float("inf", &f));
+    TEST_ASSERT(parse_float("027", &f) > 0);
+    TEST_ASSERT(f == 27.0F);
+
+    // halfway between two floats: ties to even, any further digit rounds up
+    TEST_ASSERT(parse_float("16777217", &f) > 0);
+    TEST_ASSERT(f == 16777216.0F);
+    TEST_ASSERT(parse_float("16777219", &f) > 0);
+    TEST_ASSERT(f == 16777220.0F);
+    TEST_ASSERT(parse_float("16777217.000000000000000000000000000001", &f) > 0);
+    TEST_ASSERT(f == 16777218.0F);
+}
+
+void test_json_parse_tokens()
+{
+    // nested containers and a string longer than the scanned blocks
+    const char js[] = "{\"Info\":{\"Name\":\"MPPT 2420 HC with a \\\"long\\\" device name\","
+        "\"IDs\":[12,-3.5e2]},\"Bat_V\":14.4,\"Load\":true}";
+    const jsmntok_t expected[] = {
+        { JSMN_OBJECT, 0, 103, 3 },
+        { JSMN_STRING, 2, 6, 1 },
+        { JSMN_OBJECT, 8, 77, 2 },
+        { JSMN_STRING, 10, 14, 1 },
+        { JSMN_STRING, 17, 57, 0 },
+        { JSMN_STRING, 60, 63, 1 },
+        { JSMN_ARRAY, 65, 76, 2 },
+        { JSMN_PRIMITIVE, 66, 68, 0 },
+        { JSMN_PRIMITIVE, 69, 75, 0 },
+        { JSMN_STRING, 79, 84, 1 },
+        { JSMN_PRIMITIVE, 86, 90, 0 },
+        { JSMN_STRING, 92, 96, 1 },
+        { JSMN_PRIMITIVE, 98, 102, 0 },
+    };
+    const int num_expected = sizeof(expected) / sizeof(expected[0]);
+    jsmntok_t tokens[20];
+    jsmn_parser parser;
+
+    jsmn_init(&parser);
+    TEST_ASSERT_EQUAL(num_expected, jsmn_parse(&parser, js, strlen(js), tokens, 20));
+    for (int i = 0; i < num_expected; i++) {
+        TEST_ASSERT_EQUAL(expected[i].type, tokens[i].type);
+        TEST_ASSERT_EQUAL(expected[i].start, tokens[i].start);
+        TEST_ASSERT_EQUAL(expected[i].end, tokens[i].end);
+        TEST_ASSERT_EQUAL(expected[i].size, tokens[i].size);
+    }
+
+    // same result if parsed in chunks, as done by ThingSet::feed
+    jsmn_init(&parser);
+    TEST_ASSERT_EQUAL(JSMN_ERROR_PART, jsmn_parse(&parser, js, 40, tokens, 20));
+    TEST_ASSERT_EQUAL(JSMN_ERROR_PART, jsmn_parse(&parser, js, 85, tokens, 20));
+    TEST_ASSERT_EQUAL(num_expected, jsmn_parse(&parser, js, strlen(js), tokens, 20));
+    TEST_ASSERT_EQUAL(103, tokens[0].end);
+    TEST_ASSERT_EQUAL(3, tokens[0].size);
+    TEST_ASSERT_EQUAL(77, tokens[2].end);
+
+    // invalid characters are still detected inside long primitives and unmatched brackets
+    jsmn_init(&parser);
+    TEST_ASSERT_EQUAL(JSMN_ERROR_INVAL,
+        jsmn_parse(&parser, "[1234567890123456789\x7f]", 22, tokens, 20));
+    jsmn_init(&parser);
+    TEST_ASSERT_EQUAL(JSMN_ERROR_INVAL, jsmn_parse(&parser, "{\"a\":[1,2}}", 11, tokens, 20));
+}
+
+void test_json_serialize_string()
+{
+    char buf[100];
+    char str[40];
+
+    TEST_ASSERT_EQUAL(5, json_serialize_string(buf, "abc", 3, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("\"abc\"", buf);
+    TEST_ASSERT_EQUAL(2, json_serialize_string(buf, "", 0, sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("\"\"", buf);
+
+    const char *special = "a\"b\\c\nd\x01\x7F\xC3\xA4";
+    TEST_ASSERT_EQUAL(21, json_serialize_string(buf, special, strlen(special), sizeof(buf)));
+    TEST_ASSERT_EQUAL_STRING("\"a\\\"b\\\\c\\nd\\u0001\x7F\xC3\xA4\"", buf);
+    TEST_ASSERT_EQUAL(21, json_serialize_string(NULL, special, strlen(special), 0));
+
+    // exact bounds check (including null termination)
+    for (int size = 0; size <= 21; size++) {
+        TEST_ASSERT_EQUAL(0, json_serialize_string(buf, special, strlen(special), size));
+    }
+    TEST_ASSERT_EQUAL(21, json_serialize_string(buf, special, strlen(special), 22));
+
+    // special character at each position of a long string (word-wise and bytewise scan)
+    for (unsigned int pos = 0; pos < sizeof(str); pos++) {
+        memset(str, 'x', sizeof(str));
+        for (int c = 0; c < 256; c++) {
+            str[pos] = (char)c;
+            bool escape = (c < 0x20 || c == '"' || c == '\\');
+            TEST_ASSERT_EQUAL(escape ? pos : sizeof(str), json_find_escape(str, sizeof(str)));
+        }
+        // not found if outside of the specified length
+        str[pos] = '"';
+        TEST_ASSERT_EQUAL(pos, json_find_escape(str, pos));
+    }
+}
+
+static char escaped_str[] = "say \"hi\"\n";
+
+static DataNode escape_nodes[] = {
+    TS_NODE_PATH(0x01, "info", 0, NULL),
+    TS_NODE_STRING(0x02, "DeviceID", escaped_str, sizeof(escaped_str), 0x01, TS_ANY_R, 0),
+    TS_NODE_STRING(0x03, "tab\tname", escaped_str, sizeof(escaped_str), 0x01, TS_ANY_R, 0),
+};
+
+void test_txt_get_escaped_strings()
+{
+    ThingSet ts_escape(escape_nodes, sizeof(escape_nodes)/sizeof(DataNode));
+    const char expected[] = ":85 Content. "
+        "{\"DeviceID\":\"say \\\"hi\\\"\\n\",\"tab\\tname\":\"say \\\"hi\\\"\\n\"}";
+
+    size_t req_len = snprintf((char *)req_buf, TS_REQ_BUFFER_LEN, "?info");
+    int resp_len = ts_escape.process(req_buf, req_len, resp_buf, TS_RESP_BUFFER_LEN);
+    TEST_ASSERT_EQUAL(strlen((char *)resp_buf), resp_len);
+    TEST_ASSERT_EQUAL_STRING(expected, resp_buf);
+    TEST_ASSERT_EQUAL(resp_len, ts_escape.process_size(req_buf, req_len));
+
+    // names with special characters are copied instead of referenced in scatter-gather mode
+    TsIoVec iov[8];
+    char scratch[100];
+    char msg[100];
+    int count = ts_escape.process(req_buf, req_len, iov, 8, (uint8_t *)scratch, sizeof(scratch));
+    TEST_ASSERT_EQUAL(resp_len, iov_concat(iov, count, msg, sizeof(msg)));
+    TEST_ASSERT_EQUAL_STRING(expected, msg);
+}
+
 void tests_text_mode()
 {
     UNITY_BEGIN();
@@ -370,10 +1279,18 @@ void tests_text_mode()
     // GET request
     RUN_TEST(test_txt_get_output_names);
     RUN_TEST(test_txt_get_output_names_values);
+    RUN_TEST(test_txt_get_readable_names_only);
+    RUN_TEST(test_txt_get_streamed);
+    RUN_TEST(test_txt_get_streamed_sink_failure);
+    RUN_TEST(test_txt_pub_during_streamed_get);
+    RUN_TEST(test_txt_get_iov);
+    RUN_TEST(test_txt_get_escaped_strings);
+    RUN_TEST(test_txt_response_size);
 
     // FETCH request
     RUN_TEST(test_txt_fetch_array);
     RUN_TEST(test_txt_fetch_rounded);
+    RUN_TEST(test_txt_fetch_shortest_float);
     RUN_TEST(test_txt_fetch_nan);
     RUN_TEST(test_txt_fetch_inf);
     RUN_TEST(test_txt_fetch_int32_array);
@@ -385,6 +1302,7 @@ void tests_text_mode()
     RUN_TEST(test_txt_patch_readonly);
     RUN_TEST(test_txt_patch_wrong_path);
     RUN_TEST(test_txt_patch_unknown_node);
+    RUN_TEST(test_txt_patch_all_or_nothing);
     RUN_TEST(test_txt_conf_callback);
 
     // POST request
@@ -392,9 +1310,19 @@ void tests_text_mode()
 
     // pub/sub messages
     RUN_TEST(test_txt_pub_msg);
+    RUN_TEST(test_json_serialize_numbers);
+    RUN_TEST(test_json_serialize_arrays);
+    RUN_TEST(test_json_parse_tokens);
+    RUN_TEST(test_json_serialize_string);
+    RUN_TEST(test_json_deserialize_numbers);
     RUN_TEST(test_txt_pub_list_channels);
     RUN_TEST(test_txt_pub_enable);
     RUN_TEST(test_txt_pub_delete_append_node);
+    RUN_TEST(test_txt_pub_msg_after_delete_append);
+    RUN_TEST(test_txt_pub_msg_streamed);
+    RUN_TEST(test_txt_pub_msg_iov);
+    RUN_TEST(test_txt_pub_delta);
+    RUN_TEST(test_txt_pub_template);
 
     // authentication
     RUN_TEST(test_txt_auth_user);
@@ -404,8 +1332,12 @@ void tests_text_mode()
     RUN_TEST(test_txt_auth_reset);
 
     // general tests
+    RUN_TEST(test_txt_json_tokens);
+    RUN_TEST(test_txt_large_payload);
+    RUN_TEST(test_txt_feed);
     RUN_TEST(test_txt_wrong_command);
     RUN_TEST(test_txt_get_endpoint);
+    RUN_TEST(test_txt_get_endpoint_deep_path);
 
     UNITY_END();
 }